@@ -22,147 +22,12 @@
 
 --------------------------------------------------------------------------------------*/
 #include "DMD32Plus.h"
+#include "esp32-hal-periman.h"
+#include "soc/soc_caps.h"
 #include "utils.h"
-
-struct ArabicLetterForm
-{
-    uint16_t codepoint;
-    uint8_t isolated;
-    uint8_t final;
-    uint8_t initial;
-    uint8_t medial;
-    bool joinBefore;
-    bool joinAfter;
-};
-
-static const uint8_t ARABIC_GLYPH_TATWEEL = 0xEF;
-static const uint8_t ARABIC_GLYPH_SPACE = 0xF0;
-static const uint8_t ARABIC_GLYPH_DIGIT_0 = 0xF1;
-static const uint8_t ARABIC_GLYPH_COMMA = 0xFB;
-static const uint8_t ARABIC_GLYPH_DOT = 0xFC;
-static const uint8_t ARABIC_GLYPH_QUESTION = 0xFD;
-static const uint8_t ARABIC_GLYPH_LAM_ALEF_ISO = 0xFE;
-static const uint8_t ARABIC_GLYPH_LAM_ALEF_FINAL = 0xFF;
-
-static const ArabicLetterForm kArabicForms[] = {
-    {0x0621, 0x80, 0x80, 0x80, 0x80, false, false}, // hamza
-    {0x0622, 0x81, 0x82, 0x81, 0x82, true, false},  // alef madda
-    {0x0623, 0x83, 0x84, 0x83, 0x84, true, false},  // alef hamza above
-    {0x0625, 0x85, 0x86, 0x85, 0x86, true, false},  // alef hamza below
-    {0x0627, 0x87, 0x88, 0x87, 0x88, true, false},  // alef
-    {0x0628, 0x89, 0x8A, 0x8B, 0x8C, true, true},   // beh
-    {0x0629, 0x8D, 0x8E, 0x8D, 0x8E, true, false},  // teh marbuta
-    {0x062A, 0x8F, 0x90, 0x91, 0x92, true, true},   // teh
-    {0x062B, 0x93, 0x94, 0x95, 0x96, true, true},   // theh
-    {0x062C, 0x97, 0x98, 0x99, 0x9A, true, true},   // jeem
-    {0x062D, 0x9B, 0x9C, 0x9D, 0x9E, true, true},   // hah
-    {0x062E, 0x9F, 0xA0, 0xA1, 0xA2, true, true},   // khah
-    {0x062F, 0xA3, 0xA4, 0xA3, 0xA4, true, false},  // dal
-    {0x0630, 0xA5, 0xA6, 0xA5, 0xA6, true, false},  // thal
-    {0x0631, 0xA7, 0xA8, 0xA7, 0xA8, true, false},  // reh
-    {0x0632, 0xA9, 0xAA, 0xA9, 0xAA, true, false},  // zain
-    {0x0633, 0xAB, 0xAC, 0xAD, 0xAE, true, true},   // seen
-    {0x0634, 0xAF, 0xB0, 0xB1, 0xB2, true, true},   // sheen
-    {0x0635, 0xB3, 0xB4, 0xB5, 0xB6, true, true},   // sad
-    {0x0636, 0xB7, 0xB8, 0xB9, 0xBA, true, true},   // dad
-    {0x0637, 0xBB, 0xBC, 0xBD, 0xBE, true, true},   // tah
-    {0x0638, 0xBF, 0xC0, 0xC1, 0xC2, true, true},   // zah
-    {0x0639, 0xC3, 0xC4, 0xC5, 0xC6, true, true},   // ain
-    {0x063A, 0xC7, 0xC8, 0xC9, 0xCA, true, true},   // ghain
-    {0x0641, 0xCB, 0xCC, 0xCD, 0xCE, true, true},   // feh
-    {0x0642, 0xCF, 0xD0, 0xD1, 0xD2, true, true},   // qaf
-    {0x0643, 0xD3, 0xD4, 0xD5, 0xD6, true, true},   // kaf
-    {0x0644, 0xD7, 0xD8, 0xD9, 0xDA, true, true},   // lam
-    {0x0645, 0xDB, 0xDC, 0xDD, 0xDE, true, true},   // meem
-    {0x0646, 0xDF, 0xE0, 0xE1, 0xE2, true, true},   // noon
-    {0x0647, 0xE3, 0xE4, 0xE5, 0xE6, true, true},   // heh
-    {0x0648, 0xE7, 0xE8, 0xE7, 0xE8, true, false},  // waw
-    {0x0649, 0xE9, 0xEA, 0xE9, 0xEA, true, false},  // alef maksura
-    {0x064A, 0xEB, 0xEC, 0xED, 0xEE, true, true},   // yeh
-    {0x0640, 0xEF, 0xEF, 0xEF, 0xEF, true, true}    // tatweel
-};
-
-static const ArabicLetterForm *findArabicForm(uint16_t codepoint)
-{
-    for (size_t i = 0; i < (sizeof(kArabicForms) / sizeof(kArabicForms[0])); i++)
-    {
-        if (kArabicForms[i].codepoint == codepoint)
-        {
-            return &kArabicForms[i];
-        }
-    }
-    return NULL;
-}
-
-static bool decodeNextUtf8Codepoint(const uint8_t *&src, uint16_t &codepoint)
-{
-    if (!src || !*src)
-    {
-        return false;
-    }
-
-    if ((*src & 0x80) == 0)
-    {
-        codepoint = *src;
-        src++;
-        return true;
-    }
-
-    if (((*src & 0xE0) == 0xC0) && src[1])
-    {
-        codepoint = (((uint16_t)(*src & 0x1F)) << 6) | (src[1] & 0x3F);
-        src += 2;
-        return true;
-    }
-
-    if (((*src & 0xF0) == 0xE0) && src[1] && src[2])
-    {
-        codepoint = (((uint16_t)(*src & 0x0F)) << 12) |
-                    (((uint16_t)(src[1] & 0x3F)) << 6) |
-                    (src[2] & 0x3F);
-        src += 3;
-        return true;
-    }
-
-    src++;
-    while ((*src & 0xC0) == 0x80)
-    {
-        src++;
-    }
-    return false;
-}
-
-static uint8_t mapArabicSymbolCodepoint(uint16_t codepoint)
-{
-    // Latin ASCII characters (font now includes 0x20-0x7F range)
-    if (codepoint >= 0x0020 && codepoint <= 0x007E)
-    {
-        return (uint8_t)codepoint;  // Direct mapping
-    }
-    
-    // Arabic-Indic digits map to Western digits
-    if (codepoint >= 0x0660 && codepoint <= 0x0669)
-    {
-        return 0x30 + (codepoint - 0x0660);  // Map to '0'-'9'
-    }
-    if (codepoint >= 0x06F0 && codepoint <= 0x06F9)
-    {
-        return 0x30 + (codepoint - 0x06F0);  // Map to '0'-'9'
-    }
-
-    // Arabic punctuation maps
-    switch (codepoint)
-    {
-    case 0x060C:
-        return ARABIC_GLYPH_COMMA;
-    case 0x061F:
-        return ARABIC_GLYPH_QUESTION;
-    case 0x0640:
-        return ARABIC_GLYPH_TATWEEL;
-    default:
-        return 0;
-    }
-}
+#include "DMDArabic.h"
+#include "DMDBidi.h"
+#include "DMDUtf8.h"
 
 /*--------------------------------------------------------------------------------------
  Setup and instantiation of DMD library
@@ -179,7 +44,7 @@ DMD::DMD(byte panelsWide, byte panelsHigh)
     _clkPin = PIN_DMD_CLK;
     _rDataPin = PIN_DMD_R_DATA;
 
-    init(panelsWide, panelsHigh);
+    init(panelsWide, panelsHigh, NULL, NULL, NULL);
 }
 
 DMD::DMD(
@@ -194,10 +59,27 @@ DMD::DMD(
     _clkPin = clkPin;
     _rDataPin = rDataPin;
 
-    init(panelsWide, panelsHigh);
+    init(panelsWide, panelsHigh, NULL, NULL, NULL);
 }
 
-void DMD::init(byte panelsWide, byte panelsHigh)
+DMD::DMD(
+    byte panelsWide, byte panelsHigh,
+    uint8_t nOEPin, uint8_t aPin, uint8_t bPin, uint8_t clkPin, uint8_t latPin, uint8_t rDataPin,
+    byte *screenRAM, byte *scanRAM, int16_t *dirtyRows
+) {
+    _aPin = aPin;
+    _bPin = bPin;
+    _latPin = latPin;
+    _nOEPin = nOEPin;
+
+    _clkPin = clkPin;
+    _rDataPin = rDataPin;
+
+    init(panelsWide, panelsHigh, screenRAM, scanRAM, dirtyRows);
+}
+
+// The buffers not given are allocated
+void DMD::init(byte panelsWide, byte panelsHigh, byte *screenRAM, byte *scanRAM, int16_t *dirtyRows)
 {
     uint16_t ui;
     DisplaysWide = panelsWide;
@@ -206,13 +88,27 @@ void DMD::init(byte panelsWide, byte panelsHigh)
     row1 = DisplaysTotal << 4;
     row2 = DisplaysTotal << 5;
     row3 = ((DisplaysTotal << 2) * 3) << 2;
-    bDMDScreenRAM = (byte *)malloc(DisplaysTotal * DMD_RAM_SIZE_BYTES);   
-
-    // initialise instance of the SPIClass attached to vspi
-    vspi = new SPIClass(VSPI);
-
-    // initialize the SPI port
-    vspi->begin(_clkPin, -1, _rDataPin, -1);
+    bDMDScreenRAM = screenRAM ? screenRAM : (byte *)malloc(DisplaysTotal * DMD_RAM_SIZE_BYTES);
+    bDMDScanRAM = scanRAM ? scanRAM : (byte *)malloc(DisplaysTotal * DMD_RAM_SIZE_BYTES);
+    bScanMode = SCAN_MODE_BURST;
+    bDMDFrontRAM = bDMDScreenRAM;
+    bDMDPendingRAM = NULL;
+    bDoubleBuffered = false;
+    bCopyOnSwap = false;
+    if (dirtyRows == NULL)
+        dirtyRows = (int16_t *)malloc(2 * DisplaysHigh * DMD_PIXELS_DOWN * sizeof(int16_t));
+    dirtyMinX = dirtyRows;
+    dirtyMaxX = dirtyRows + DisplaysHigh * DMD_PIXELS_DOWN;
+    clearDirty();
+    for (byte i = 0; i < 4; i++)
+        bStageDirty[i] = true;
+    bScanning = false;
+    scanPeriodUs = 0;
+
+    // initialise the default bus attached to vspi and the SPI port
+    spiBus = new DMDVSPIBus(spiClk);
+    spiBus->begin(_clkPin, _rDataPin);
+    bOwnsSpiBus = true;
 
     // setup pin mode
     pinMode(_aPin, OUTPUT);
@@ -227,11 +123,28 @@ void DMD::init(byte panelsWide, byte panelsHigh)
     digitalWrite(_latPin, LOW);
     digitalWrite(_nOEPin, LOW); 
 
+    bIntensity = DMD_MAX_INTENSITY;
+    bBrightness = 255;
+    oeSignal = SIG_GPIO_OUT_IDX;
+    bPwmAttached = false;
     clearScreen(true);
     marqueeNoSpacing = false;
+    marqueeText = NULL;
+    marqueeLength = 0;
+    marqueeCapacity = 0;
+    marqueeWidth = 0;
+    marqueeSource = NULL;
+    bMarqueeStrip = false;
+    marqueeStrip = NULL;
+    marqueeStripWords = 0;
+    marqueeStripRows = 0;
+    shapeCache = NULL;
+    clearClip();
 
     // init the scan line/ram pointer to the required start point
     bDMDByte = 0;
+    bDMDPlane = 0;
+    bPlaneHold = 0;
 }
 
 // DMD::~DMD()
@@ -250,70 +163,70 @@ void DMD::writePixel(unsigned int bX, unsigned int bY, byte bGraphicsMode, byte
     {
         return;
     }
+    unsigned int bX0 = bX, bY0 = bY;
     byte panel = (bX / DMD_PIXELS_ACROSS) + (DisplaysWide * (bY / DMD_PIXELS_DOWN));
     bX = (bX % DMD_PIXELS_ACROSS) + (panel << 5);
     bY = bY % DMD_PIXELS_DOWN;
     // set pointer to DMD RAM byte to be modified
     uiDMDRAMPointer = bX / 8 + bY * (DisplaysTotal << 2);
 
-    byte lookup = bPixelLookupTable[bX & 0x07];
+    writeRamPixel(uiDMDRAMPointer, bPixelLookupTable[bX & 0x07], DMD_PLANE_SIZE_BYTES * DisplaysTotal, bGraphicsMode, bPixel);
+    markDirty(bX0, bY0, bX0, bY0);
+}
 
-    switch (bGraphicsMode)
-    {
-    case GRAPHICS_NORMAL:
-        if (bPixel == true)
-            bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup; // zero bit is pixel on
-        else
-            bDMDScreenRAM[uiDMDRAMPointer] |= lookup; // one bit is pixel off
-        break;
-    case GRAPHICS_INVERSE:
-        if (bPixel == false)
-            bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup; // zero bit is pixel on
-        else
-            bDMDScreenRAM[uiDMDRAMPointer] |= lookup; // one bit is pixel off
-        break;
-    case GRAPHICS_TOGGLE:
-        if (bPixel == true)
-        {
-            if ((bDMDScreenRAM[uiDMDRAMPointer] & lookup) == 0)
-                bDMDScreenRAM[uiDMDRAMPointer] |= lookup; // one bit is pixel off
-            else
-                bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup; // one bit is pixel off
-        }
-        break;
-    case GRAPHICS_OR:
-        // only set pixels on
-        if (bPixel == true)
-            bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup; // zero bit is pixel on
-        break;
-    case GRAPHICS_NOR:
-        // only clear on pixels
-        if ((bPixel == true) &&
-            ((bDMDScreenRAM[uiDMDRAMPointer] & lookup) == 0))
-            bDMDScreenRAM[uiDMDRAMPointer] |= lookup; // one bit is pixel off
-        break;
-    }
-}
-
-void DMD::drawString(int bX, int bY, const char *bChars, byte length,
+void DMD::writePixelLevel(unsigned int bX, unsigned int bY, byte bLevel)
+{
+    byte intensity = bIntensity;
+    setIntensity(bLevel);
+    writePixel(bX, bY, GRAPHICS_NORMAL, true);
+    bIntensity = intensity;
+}
+
+byte DMD::readPixelLevel(unsigned int bX, unsigned int bY)
+{
+    if (bX >= (DMD_PIXELS_ACROSS * DisplaysWide) || bY >= (DMD_PIXELS_DOWN * DisplaysHigh))
+        return 0;
+    byte panel = (bX / DMD_PIXELS_ACROSS) + (DisplaysWide * (bY / DMD_PIXELS_DOWN));
+    bX = (bX % DMD_PIXELS_ACROSS) + (panel << 5);
+    bY = bY % DMD_PIXELS_DOWN;
+    unsigned int uiDMDRAMPointer = bX / 8 + bY * (DisplaysTotal << 2);
+    return readRamLevel(uiDMDRAMPointer, bPixelLookupTable[bX & 0x07], DMD_PLANE_SIZE_BYTES * DisplaysTotal);
+}
+
+int DMD::getWidth()
+{
+    return DMD_PIXELS_ACROSS * DisplaysWide;
+}
+
+int DMD::getHeight()
+{
+    return DMD_PIXELS_DOWN * DisplaysHigh;
+}
+
+void DMD::setIntensity(byte bLevel)
+{
+    bIntensity = (bLevel > DMD_MAX_INTENSITY) ? DMD_MAX_INTENSITY : bLevel;
+}
+
+void DMD::drawString(int bX, int bY, const char *bChars, unsigned int length,
                      byte bGraphicsMode)
 {
     if (bX >= (DMD_PIXELS_ACROSS * DisplaysWide) || bY >= DMD_PIXELS_DOWN * DisplaysHigh)
         return;
-    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
+    uint8_t height = this->Font.getHeight();
     if (bY + height < 0)
         return;
 
     int strWidth = 0;
-    this->drawLine(bX - 1, bY, bX - 1, bY + height, GRAPHICS_INVERSE);
+    blitColumns(bX - 1, bY, NULL, 1, height, height + 1, GRAPHICS_INVERSE);
 
-    for (int i = 0; i < length; i++)
+    for (unsigned int i = 0; i < length; i++)
     {
         int charWide = this->drawChar(bX + strWidth, bY, bChars[i], bGraphicsMode);
         if (charWide > 0)
         {
             strWidth += charWide;
-            this->drawLine(bX + strWidth, bY, bX + strWidth, bY + height, GRAPHICS_INVERSE);
+            blitColumns(bX + strWidth, bY, NULL, 1, height, height + 1, GRAPHICS_INVERSE);
             strWidth++;
         }
         else if (charWide < 0)
@@ -325,17 +238,17 @@ void DMD::drawString(int bX, int bY, const char *bChars, byte length,
     }
 }
 
-void DMD::drawStringCompact(int bX, int bY, const char *bChars, byte length,
+void DMD::drawStringCompact(int bX, int bY, const char *bChars, unsigned int length,
                             byte bGraphicsMode)
 {
     if (bX >= (DMD_PIXELS_ACROSS * DisplaysWide) || bY >= DMD_PIXELS_DOWN * DisplaysHigh)
         return;
-    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
+    uint8_t height = this->Font.getHeight();
     if (bY + height < 0)
         return;
 
     int strWidth = 0;
-    for (int i = 0; i < length; i++)
+    for (unsigned int i = 0; i < length; i++)
     {
         int charWide = this->drawChar(bX + strWidth, bY, bChars[i], bGraphicsMode);
         if (charWide > 0)
@@ -351,17 +264,17 @@ void DMD::drawStringCompact(int bX, int bY, const char *bChars, byte length,
     }
 }
 
-void DMD::drawStringRTL(int rightX, int bY, const char *bChars, byte length, byte bGraphicsMode)
+void DMD::drawStringRTL(int rightX, int bY, const char *bChars, unsigned int length, byte bGraphicsMode)
 {
     if (bY >= DMD_PIXELS_DOWN * DisplaysHigh)
         return;
-    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
+    uint8_t height = this->Font.getHeight();
     if (bY + height < 0)
         return;
 
     int screenW = DMD_PIXELS_ACROSS * DisplaysWide;
     int cursorX = rightX;
-    for (int i = 0; i < length; i++)
+    for (unsigned int i = 0; i < length; i++)
     {
         unsigned char c = (unsigned char)bChars[i];
         int charWide = this->charWidth(c);
@@ -386,168 +299,309 @@ void DMD::drawStringRTL(int rightX, int bY, const char *bChars, byte length, byt
     }
 }
 
-uint16_t DMD::utf8ToArabic(const char *utf8Text, char *outBuffer, uint16_t outBufferSize)
+unsigned int DMD::utf8ToArabic(const char *utf8Text, char *outBuffer, unsigned int outBufferSize)
 {
     if (!utf8Text || !outBuffer || outBufferSize == 0)
     {
         return 0;
     }
 
-    uint16_t codepoints[256];
-    uint16_t codepointCount = 0;
-    const uint8_t *src = (const uint8_t *)utf8Text;
-
-    while (*src && codepointCount < (sizeof(codepoints) / sizeof(codepoints[0])))
+    // printable ASCII is its own glyphs and never joins, so a leading run of it is copied and
+    // the shaper starts after it as it would at the start of the text
+    unsigned int textLength = strlen(utf8Text);
+    unsigned int outLen = dmdAsciiPrefix(utf8Text, textLength);
+    if (outLen > outBufferSize - 1)
+        outLen = outBufferSize - 1;
+    memcpy(outBuffer, utf8Text, outLen);
+
+    // shaped as it is decoded, the shaper holds the only codepoints needed
+    DMDArabicShaper shaper;
+    DMDUtf8Iterator text(utf8Text + outLen, textLength - outLen);
+    boolean more = true;
+    while (more && outLen < (outBufferSize - 1))
     {
-        uint16_t codepoint = 0;
-        if (decodeNextUtf8Codepoint(src, codepoint))
+        uint32_t codepoint;
+        if (!text.next(codepoint))
         {
-            codepoints[codepointCount++] = codepoint;
+            codepoint = 0;
+            more = false;
+        }
+
+        uint8_t mapped = shaper.push(codepoint);
+        if (mapped != 0)
+        {
+            outBuffer[outLen++] = (char)mapped;
         }
     }
 
-    uint16_t outLen = 0;
-    for (uint16_t i = 0; i < codepointCount && outLen < (outBufferSize - 1); i++)
+    outBuffer[outLen] = '\0';
+    return outLen;
+}
+
+const char *DMD::shapeArabic(const char *utf8Text, unsigned int &length, int &width, boolean &owned)
+{
+    owned = false;
+    // text of printable ASCII alone is a left to right paragraph, drawn as it is
+    unsigned int size = strlen(utf8Text);
+    if (dmdAsciiPrefix(utf8Text, size) == size)
     {
-        uint16_t cp = codepoints[i];
-        uint8_t mapped = 0;
+        length = size;
+        width = measureStringCompact(utf8Text, length);
+        return utf8Text;
+    }
 
-        if (cp == 0x0644 && (i + 1) < codepointCount)
+    if (shapeCache != NULL)
+    {
+        const DMDShapedRun *run = shapeCache->find(utf8Text, this->Font.getFont());
+        if (run != NULL)
         {
-            uint16_t nextCp = codepoints[i + 1];
-            if (nextCp == 0x0627 || nextCp == 0x0622 || nextCp == 0x0623 || nextCp == 0x0625)
-            {
-                const ArabicLetterForm *prev = (i > 0) ? findArabicForm(codepoints[i - 1]) : NULL;
-                bool joinWithPrev = (prev != NULL) && prev->joinAfter;
-                mapped = joinWithPrev ? ARABIC_GLYPH_LAM_ALEF_FINAL : ARABIC_GLYPH_LAM_ALEF_ISO;
-                i++;
-            }
+            length = run->length;
+            width = run->width;
+            return run->glyphs;
         }
+    }
 
-        if (mapped == 0)
-        {
-            const ArabicLetterForm *curr = findArabicForm(cp);
-            if (curr != NULL)
-            {
-                const ArabicLetterForm *prev = (i > 0) ? findArabicForm(codepoints[i - 1]) : NULL;
-                const ArabicLetterForm *next = (i + 1 < codepointCount) ? findArabicForm(codepoints[i + 1]) : NULL;
+    // never more glyphs than UTF-8 bytes, the bidi classes and levels follow the glyphs
+    size++;
+    char *glyphs = (char *)malloc(size * 3);
+    if (glyphs == NULL)
+        return NULL;
+    length = utf8ToArabic(utf8Text, glyphs, size);
+    uint8_t *classes = (uint8_t *)glyphs + size;
+    uint8_t *levels = classes + size;
+    for (unsigned int i = 0; i < length; i++)
+        classes[i] = DMDBidi::glyphClass((uint8_t)glyphs[i]);
+    DMDBidi::resolve(classes, length, 1, levels);
+    DMDBidi::reorder(glyphs, levels, length);
+    width = measureStringCompact(glyphs, length);
+
+    const DMDShapedRun *run = (shapeCache != NULL) ? shapeCache->insert(utf8Text, this->Font.getFont(), glyphs, length, width) : NULL;
+    if (run != NULL)
+    {
+        free(glyphs);
+        return run->glyphs;
+    }
+    owned = true;
+    return glyphs;
+}
 
-                bool joinWithPrev = (prev != NULL) && prev->joinAfter && curr->joinBefore;
-                bool joinWithNext = (next != NULL) && curr->joinAfter && next->joinBefore;
+void DMD::setShapeCache(DMDShapeCache *cache)
+{
+    shapeCache = cache;
+}
 
-                if (joinWithPrev && joinWithNext)
-                {
-                    mapped = curr->medial;
-                }
-                else if (joinWithPrev)
-                {
-                    mapped = curr->final;
-                }
-                else if (joinWithNext)
-                {
-                    mapped = curr->initial;
-                }
-                else
-                {
-                    mapped = curr->isolated;
-                }
-            }
-            else
-            {
-                mapped = mapArabicSymbolCodepoint(cp);
-            }
-        }
+/*--------------------------------------------------------------------------------------
+ Text measurement, from the advance table of the font: a glyph of drawString takes its
+ width and a blank column, letters not in the font nothing
+--------------------------------------------------------------------------------------*/
+int DMD::measureString(const char *bChars, unsigned int length)
+{
+    const uint8_t *advances = this->Font.getAdvances();
+    if (advances == NULL)
+        return 0;
+    int width = 0;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        uint8_t wide = advances[(uint8_t)bChars[i]];
+        width += wide + (wide != 0);
+    }
+    // no blank column after the last glyph
+    return (width > 0) ? width - 1 : 0;
+}
 
-        if (mapped != 0)
+int DMD::measureStringCompact(const char *bChars, unsigned int length)
+{
+    const uint8_t *advances = this->Font.getAdvances();
+    if (advances == NULL)
+        return 0;
+    int width = 0;
+    for (unsigned int i = 0; i < length; i++)
+        width += advances[(uint8_t)bChars[i]];
+    return width;
+}
+
+int DMD::measureArabic(const char *utf8Text)
+{
+    const uint8_t *advances = this->Font.getAdvances();
+    if (!utf8Text || advances == NULL)
+        return 0;
+    unsigned int textLength = strlen(utf8Text);
+    unsigned int ascii = dmdAsciiPrefix(utf8Text, textLength);
+    if (ascii == textLength)
+        return measureStringCompact(utf8Text, textLength);
+    if (shapeCache != NULL)
+    {
+        const DMDShapedRun *run = shapeCache->find(utf8Text, this->Font.getFont());
+        if (run != NULL)
+            return run->width;
+    }
+
+    // the visual order does not change the width, so the glyphs are summed as they are shaped
+    int width = measureStringCompact(utf8Text, ascii);
+    DMDArabicShaper shaper;
+    DMDUtf8Iterator text(utf8Text + ascii, textLength - ascii);
+    boolean more = true;
+    while (more)
+    {
+        uint32_t codepoint;
+        if (!text.next(codepoint))
         {
-            outBuffer[outLen++] = (char)mapped;
+            codepoint = 0;
+            more = false;
         }
+        uint8_t glyph = shaper.push(codepoint);
+        if (glyph != 0)
+            width += advances[glyph];
     }
-
-    outBuffer[outLen] = '\0';
-    return outLen;
+    return width;
 }
 
-static void reverseArabicVisual(char *buf, uint16_t len)
+int DMD::alignX(int width, int x1, int x2, byte align)
 {
-    // Reverse entire buffer for RTL visual order
-    for (uint16_t i = 0; i < len / 2; i++)
+    switch (align)
     {
-        char tmp = buf[i];
-        buf[i] = buf[len - 1 - i];
-        buf[len - 1 - i] = tmp;
+    case DMD_ALIGN_CENTER:
+        return x1 + (x2 - x1 + 1 - width) / 2;
+    case DMD_ALIGN_RIGHT:
+        return x2 + 1 - width;
     }
-    
-    // Re-reverse Latin/digit sequences so they read LTR within RTL text
-    uint16_t i = 0;
-    while (i < len)
+    return x1;
+}
+
+boolean DMD::drawJustified(int x1, int x2, int bY, const char *bChars, unsigned int length, int width, boolean compact, byte bGraphicsMode)
+{
+    int spaces = 0;
+    for (unsigned int i = 0; i < length; i++)
+        spaces += (bChars[i] == ' ');
+    int extra = x2 - x1 + 1 - width;
+    if (spaces == 0 || extra < 0)
+        return false;
+
+    // words are drawn as they are, each space clears its usual columns and its share of the
+    // extra ones, the first spaces taking a column more when the share does not divide evenly
+    uint8_t height = this->Font.getHeight();
+    int space = charWidth(' ');
+    int spacing = compact ? 0 : 1;
+    if (!compact)
+        blitColumns(x1 - 1, bY, NULL, 1, height, height + 1, GRAPHICS_INVERSE);
+    int x = x1, seen = 0;
+    unsigned int i = 0;
+    while (i < length)
     {
-        // Check if this is a Latin character (ASCII 0x20-0x7E) or digit
-        uint8_t ch = (uint8_t)buf[i];
-        if (ch >= 0x20 && ch <= 0x7E)
+        if (bChars[i] == ' ')
         {
-            uint16_t start = i;
-            // Find the end of this Latin sequence
-            while (i < len && (uint8_t)buf[i] >= 0x20 && (uint8_t)buf[i] <= 0x7E)
-            {
-                i++;
-            }
-            // Reverse this Latin sequence back to LTR
-            for (uint16_t a = start, b = i - 1; a < b; a++, b--)
-            {
-                char tmp = buf[a];
-                buf[a] = buf[b];
-                buf[b] = tmp;
-            }
+            int gap = extra / spaces + ((seen < extra % spaces) ? 1 : 0);
+            blitColumns(x, bY, NULL, space + 1 + gap, height, height + 1, GRAPHICS_INVERSE);
+            x += ((space > 0) ? space + spacing : 0) + gap;
+            seen++;
+            i++;
+            continue;
+        }
+        unsigned int j = i;
+        while (j < length && bChars[j] != ' ')
+            j++;
+        int advance;
+        if (compact)
+        {
+            drawStringCompact(x, bY, bChars + i, j - i, bGraphicsMode);
+            advance = measureStringCompact(bChars + i, j - i);
         }
         else
         {
-            i++;
+            drawString(x, bY, bChars + i, j - i, bGraphicsMode);
+            advance = measureString(bChars + i, j - i);
         }
+        if (advance > 0)
+            x += advance + spacing;
+        i = j;
     }
+    return true;
 }
 
-void DMD::drawArabicString(int bX, int bY, const char *utf8Text, byte bGraphicsMode)
+void DMD::drawStringAligned(int x1, int x2, int bY, const char *bChars, unsigned int length, byte align, byte bGraphicsMode)
 {
-    char mappedText[256];
-    uint16_t mappedLength = utf8ToArabic(utf8Text, mappedText, sizeof(mappedText));
-    if (mappedLength > 255)
+    int width = measureString(bChars, length);
+    if (align == DMD_ALIGN_JUSTIFY && drawJustified(x1, x2, bY, bChars, length, width, false, bGraphicsMode))
+        return;
+    drawString(alignX(width, x1, x2, align), bY, bChars, length, bGraphicsMode);
+}
+
+void DMD::drawArabicAligned(int x1, int x2, int bY, const char *utf8Text, byte align, byte bGraphicsMode)
+{
+    if (!utf8Text)
+        return;
+    unsigned int length;
+    int width;
+    boolean owned;
+    const char *glyphs = shapeArabic(utf8Text, length, width, owned);
+    if (glyphs == NULL)
+        return;
+    if (align != DMD_ALIGN_JUSTIFY || !drawJustified(x1, x2, bY, glyphs, length, width, true, bGraphicsMode))
     {
-        mappedLength = 255;
+        // right to left text starts at the right of the box
+        byte at = (align == DMD_ALIGN_JUSTIFY) ? DMD_ALIGN_RIGHT : align;
+        drawStringCompact(alignX(width, x1, x2, at), bY, glyphs, length, bGraphicsMode);
     }
-    reverseArabicVisual(mappedText, mappedLength);
-    drawStringCompact(bX, bY, mappedText, (byte)mappedLength, bGraphicsMode);
+    if (owned)
+        free((void *)glyphs);
+}
+
+void DMD::drawArabicString(int bX, int bY, const char *utf8Text, byte bGraphicsMode)
+{
+    if (!utf8Text)
+        return;
+    unsigned int length;
+    int width;
+    boolean owned;
+    const char *glyphs = shapeArabic(utf8Text, length, width, owned);
+    if (glyphs == NULL)
+        return;
+    drawStringCompact(bX, bY, glyphs, length, bGraphicsMode);
+    if (owned)
+        free((void *)glyphs);
 }
 
 void DMD::drawArabicMarquee(const char *utf8Text, int left, int top)
 {
-    char mappedText[256];
-    uint16_t mappedLength = utf8ToArabic(utf8Text, mappedText, sizeof(mappedText));
-    if (mappedLength > 255)
+    unsigned int mappedLength = 0;
+    int width = 0;
+    if (utf8Text)
     {
-        mappedLength = 255;
+        boolean owned;
+        const char *glyphs = shapeArabic(utf8Text, mappedLength, width, owned);
+        if (glyphs == NULL || !reserveMarquee(mappedLength))
+        {
+            mappedLength = 0;
+            width = 0;
+        }
+        else
+        {
+            memcpy(marqueeText, glyphs, mappedLength);
+            marqueeText[mappedLength] = '\0';
+        }
+        if (owned)
+            free((void *)glyphs);
     }
-    reverseArabicVisual(mappedText, mappedLength);
+    marqueeSource = NULL;
     marqueeNoSpacing = true;
-    marqueeWidth = 0;
-    for (uint16_t i = 0; i < mappedLength; i++)
-    {
-        marqueeText[i] = mappedText[i];
-        marqueeWidth += charWidth(mappedText[i]);
-    }
-    marqueeHeight = pgm_read_byte(this->Font + FONT_HEIGHT);
-    marqueeText[mappedLength] = '\0';
+    marqueeWidth = width;
+    marqueeHeight = this->Font.getHeight();
     marqueeOffsetY = top;
     marqueeOffsetX = left;
-    marqueeLength = (byte)mappedLength;
-    drawStringCompact(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength, GRAPHICS_NORMAL);
+    marqueeLength = mappedLength;
+    marqueeClock.restart();
+    renderMarqueeStrip();
+    drawMarqueeText();
 }
 
-void DMD::drawMarquee(const char *bChars, byte length, int left, int top)
+void DMD::drawMarquee(const char *bChars, unsigned int length, int left, int top)
 {
+    if (!reserveMarquee(length))
+        length = 0;
+    marqueeSource = NULL;
     marqueeNoSpacing = false;
     marqueeWidth = 0;
-    for (int i = 0; i < length; i++)
+    for (unsigned int i = 0; i < length; i++)
     {
         marqueeText[i] = bChars[i];
         marqueeWidth += charWidth(bChars[i]);
@@ -556,26 +610,138 @@ void DMD::drawMarquee(const char *bChars, byte length, int left, int top)
             marqueeWidth += 1;
         }
     }
-    marqueeHeight = pgm_read_byte(this->Font + FONT_HEIGHT);
-    marqueeText[length] = '\0';
+    marqueeHeight = this->Font.getHeight();
+    if (marqueeText != NULL)
+        marqueeText[length] = '\0';
     marqueeOffsetY = top;
     marqueeOffsetX = left;
     marqueeLength = length;
-    if (marqueeNoSpacing)
+    marqueeClock.restart();
+    renderMarqueeStrip();
+    drawMarqueeText();
+}
+
+boolean DMD::reserveMarquee(unsigned int length)
+{
+    if (length < marqueeCapacity)
+        return true;
+    char *text = (char *)realloc(marqueeText, length + 1);
+    if (text == NULL)
+        return false;
+    marqueeText = text;
+    marqueeCapacity = length + 1;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ Streamed marquee. Glyphs are pulled from marqueeSource only when the end of the text
+ already drawn (marqueeEdgeX: the column after it, or before it right to left) comes on
+ screen, and drawn into the columns each step uncovers. The few glyphs drawn last are
+ remembered, as they may still be partly off screen when they are drawn.
+--------------------------------------------------------------------------------------*/
+void DMD::drawMarquee(DMDTextSource *source, int top, boolean bRightToLeft)
+{
+    free(marqueeStrip);
+    marqueeStrip = NULL;
+    marqueeSource = source;
+    marqueeRightToLeft = bRightToLeft;
+    marqueeNoSpacing = bRightToLeft;
+    marqueeHeight = this->Font.getHeight();
+    marqueeOffsetY = top;
+    marqueeEdgeX = bRightToLeft ? 0 : DMD_PIXELS_ACROSS * DisplaysWide;
+    marqueeRecentCount = 0;
+    marqueeClock.restart();
+}
+
+boolean DMD::stepMarqueeSource(int amountX, int amountY)
+{
+    int width = DMD_PIXELS_ACROSS * DisplaysWide;
+    shiftScreen(amountX, amountY);
+    marqueeOffsetY += amountY;
+    marqueeEdgeX += amountX;
+    for (byte i = 0; i < marqueeRecentCount; i++)
+        marqueeRecentX[i] += amountX;
+
+    if (amountX < 0)
+        redrawRecentGlyphs(width + amountX, width - 1);
+    else if (amountX > 0)
+        redrawRecentGlyphs(0, amountX - 1);
+    else if (amountY != 0)
+        redrawRecentGlyphs(0, width - 1);
+
+    int reach = (amountX < 0) ? -amountX : amountX;
+    int spacing = marqueeNoSpacing ? 0 : 1;
+    boolean ret = false;
+    while (marqueeRightToLeft ? (marqueeEdgeX > 0) : (marqueeEdgeX < width))
     {
-        drawStringCompact(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-                          GRAPHICS_NORMAL);
+        int c = marqueeSource->next();
+        if (c == DMD_TEXT_PENDING)
+            break;
+        if (c == DMD_TEXT_END)
+        {
+            // start again once the whole text has scrolled off
+            if ((marqueeRightToLeft ? (marqueeEdgeX + spacing < width) : (marqueeEdgeX > spacing)) || !marqueeSource->rewind())
+                break;
+            marqueeEdgeX = marqueeRightToLeft ? 0 : width;
+            marqueeRecentCount = 0;
+            ret = true;
+            continue;
+        }
+        int wide = charWidth(c);
+        if (wide <= 0)
+            continue;
+
+        // text that was late arriving starts at the edge of the columns just uncovered
+        int x;
+        if (marqueeRightToLeft)
+        {
+            x = ((marqueeEdgeX < reach) ? marqueeEdgeX : reach) - wide;
+            marqueeEdgeX = x - spacing;
+        }
+        else
+        {
+            x = (marqueeEdgeX > width - reach) ? marqueeEdgeX : width - reach;
+            marqueeEdgeX = x + wide + spacing;
+        }
+        // the columns uncovered are already clear, a space has nothing left to draw
+        if (c == ' ')
+            continue;
+        drawChar(x, marqueeOffsetY, c, GRAPHICS_NORMAL);
+
+        byte slot = marqueeRecentCount;
+        if (slot == DMD_MARQUEE_RECENT)
+        {
+            slot--;
+            memmove(marqueeRecent, marqueeRecent + 1, slot);
+            memmove(marqueeRecentX, marqueeRecentX + 1, slot * sizeof(int));
+        }
+        else
+        {
+            marqueeRecentCount++;
+        }
+        marqueeRecent[slot] = c;
+        marqueeRecentX[slot] = x;
     }
-    else
+    return ret;
+}
+
+void DMD::redrawRecentGlyphs(int x1, int x2)
+{
+    for (byte i = 0; i < marqueeRecentCount; i++)
     {
-        drawString(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-                   GRAPHICS_NORMAL);
+        int x = marqueeRecentX[i];
+        if (x <= x2 && x + charWidth(marqueeRecent[i]) - 1 >= x1)
+            drawChar(x, marqueeOffsetY, marqueeRecent[i], GRAPHICS_NORMAL);
     }
 }
 
 boolean DMD::stepMarquee(int amountX, int amountY)
 {
+    if (marqueeSource != NULL)
+        return stepMarqueeSource(amountX, amountY);
+
     boolean ret = false;
+    int oldTop = marqueeOffsetY;
     marqueeOffsetX += amountX;
     marqueeOffsetY += amountY;
     if (marqueeOffsetX < -marqueeWidth)
@@ -604,86 +770,431 @@ boolean DMD::stepMarquee(int amountX, int amountY)
         ret = true;
     }
 
-    // Special case horizontal scrolling to improve speed
-    if (amountY == 0 && amountX == -1)
+    if (marqueeStrip != NULL)
+    {
+        blitMarqueeStrip(oldTop);
+        return ret;
+    }
+    if (amountX == 0 && amountY == 0)
+    {
+        drawMarqueeText();
+        return ret;
+    }
+
+    // Move what is on screen and draw only what scrolled into view
+    shiftScreen(amountX, amountY);
+
+    int width = DMD_PIXELS_ACROSS * DisplaysWide;
+    int height = DMD_PIXELS_DOWN * DisplaysHigh;
+    if (amountY != 0)
+    {
+        int y1 = (amountY < 0) ? height + amountY : 0;
+        int y2 = (amountY < 0) ? height - 1 : amountY - 1;
+        if (marqueeOffsetY <= y2 && marqueeOffsetY + marqueeHeight >= y1)
+        {
+            // uncovered rows cross the text, redraw all of it
+            redrawMarqueeColumns(0, width - 1);
+            return ret;
+        }
+    }
+    if (amountX < 0)
+        redrawMarqueeColumns(width + amountX, width - 1);
+    else if (amountX > 0)
+        redrawMarqueeColumns(0, amountX - 1);
+
+    return ret;
+}
+
+void DMD::setMarqueeSpeed(int32_t speedX, int32_t speedY)
+{
+    marqueeClock.setSpeed(speedX, speedY);
+}
+
+boolean DMD::updateMarquee(uint32_t timeUs)
+{
+    int amountX, amountY;
+    if (!marqueeClock.advance(timeUs, amountX, amountY))
+        return false;
+    return stepMarquee(amountX, amountY);
+}
+
+void DMD::redrawMarqueeColumns(int x1, int x2)
+{
+    int strWidth = marqueeOffsetX;
+    for (unsigned int i = 0; i < marqueeLength && strWidth <= x2; i++)
+    {
+        int wide = charWidth(marqueeText[i]);
+        if (strWidth + wide - 1 >= x1)
+            drawChar(strWidth, marqueeOffsetY, marqueeText[i], GRAPHICS_NORMAL);
+        strWidth += wide;
+        if (!marqueeNoSpacing)
+        {
+            strWidth += 1;
+        }
+    }
+}
+
+void DMD::drawMarqueeText()
+{
+    if (marqueeStrip != NULL)
+    {
+        blitMarqueeStrip(marqueeOffsetY);
+    }
+    else if (marqueeNoSpacing)
+    {
+        drawStringCompact(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
+                          GRAPHICS_NORMAL);
+    }
+    else
+    {
+        drawString(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
+                   GRAPHICS_NORMAL);
+    }
+}
+
+void DMD::enableMarqueeStrip(boolean bEnable)
+{
+    bMarqueeStrip = bEnable;
+    if (!bEnable)
+    {
+        free(marqueeStrip);
+        marqueeStrip = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Shift DMD RAM. A pixel row of the display is DisplaysWide * 4 contiguous bytes, so it is
+ moved as one 32 bit word per panel (most significant bit leftmost): the bits crossing the
+ seam between two panels come from the neighbouring word, the words past either end of the
+ row are unlit. Rows move whole, in every bit plane.
+--------------------------------------------------------------------------------------*/
+static inline uint32_t loadPanelWord(const byte *p)
+{
+    uint32_t word;
+    memcpy(&word, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    return word;
+}
+
+static inline void storePanelWord(byte *p, uint32_t word)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    memcpy(p, &word, 4);
+}
+
+// 32 bits of a row of words starting at any bit, bits outside the row unlit
+static inline uint32_t stripWindow(const byte *row, int words, int bit)
+{
+    int word = (bit >= 0) ? bit / 32 : -((31 - bit) / 32);
+    int shift = bit - word * 32;
+    uint32_t hi = (word >= 0 && word < words) ? loadPanelWord(row + word * 4) : 0xFFFFFFFF;
+    if (shift == 0)
+        return hi;
+    uint32_t lo = (word + 1 >= 0 && word + 1 < words) ? loadPanelWord(row + (word + 1) * 4) : 0xFFFFFFFF;
+    return (hi << shift) | (lo >> (32 - shift));
+}
+
+void DMD::shiftScreen(int amountX, int amountY)
+{
+    int width = DMD_PIXELS_ACROSS * DisplaysWide;
+    int height = DMD_PIXELS_DOWN * DisplaysHigh;
+    int rowBytes = DisplaysWide * 4;
+
+    if (amountX <= -width || amountX >= width || amountY <= -height || amountY >= height)
+    {
+        clearScreen(true);
+        return;
+    }
+
+    int words = DisplaysWide;
+    int wordShift = ((amountX < 0) ? -amountX : amountX) >> 5;
+    int bitShift = ((amountX < 0) ? -amountX : amountX) & 31;
+
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+    {
+        byte *ram = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal;
+
+        // pixel row y is row y % 16 of the panels in panel row y / 16
+#define DMD_ROW(y) (ram + ((y) % DMD_PIXELS_DOWN) * (DisplaysTotal << 2) + ((y) / DMD_PIXELS_DOWN) * rowBytes)
+        if (amountY < 0)
+        {
+            for (int y = 0; y < height; y++)
+            {
+                if (y - amountY < height)
+                    memcpy(DMD_ROW(y), DMD_ROW(y - amountY), rowBytes);
+                else
+                    memset(DMD_ROW(y), 0xFF, rowBytes);
+            }
+        }
+        else if (amountY > 0)
+        {
+            for (int y = height - 1; y >= 0; y--)
+            {
+                if (y - amountY >= 0)
+                    memcpy(DMD_ROW(y), DMD_ROW(y - amountY), rowBytes);
+                else
+                    memset(DMD_ROW(y), 0xFF, rowBytes);
+            }
+        }
+
+        if (amountX == 0)
+            continue;
+        for (int y = 0; y < height; y++)
+        {
+            byte *row = DMD_ROW(y);
+            if (amountX < 0)
+            {
+                // left, each word takes its bits from the words to its right
+                for (int w = 0; w < words; w++)
+                {
+                    int src = w + wordShift;
+                    uint32_t hi = (src < words) ? loadPanelWord(row + src * 4) : 0xFFFFFFFF;
+                    uint32_t lo = (src + 1 < words) ? loadPanelWord(row + (src + 1) * 4) : 0xFFFFFFFF;
+                    storePanelWord(row + w * 4, bitShift ? (hi << bitShift) | (lo >> (32 - bitShift)) : hi);
+                }
+            }
+            else
+            {
+                // right, each word takes its bits from the words to its left
+                for (int w = words - 1; w >= 0; w--)
+                {
+                    int src = w - wordShift;
+                    uint32_t lo = (src >= 0) ? loadPanelWord(row + src * 4) : 0xFFFFFFFF;
+                    uint32_t hi = (src - 1 >= 0) ? loadPanelWord(row + (src - 1) * 4) : 0xFFFFFFFF;
+                    storePanelWord(row + w * 4, bitShift ? (lo >> bitShift) | (hi << (32 - bitShift)) : lo);
+                }
+            }
+        }
+#undef DMD_ROW
+    }
+    markDirty(0, 0, width - 1, height - 1);
+}
+
+// Bits of panel word w (columns 32w to 32w + 31, most significant bit leftmost) in columns a to b
+static inline uint32_t columnMask(int w, int a, int b)
+{
+    int lo = (a > w * 32) ? a - w * 32 : 0;
+    int hi = (b < w * 32 + 31) ? b - w * 32 : 31;
+    if (lo > hi)
+        return 0;
+    return (0xFFFFFFFF >> lo) & (0xFFFFFFFF << (31 - hi));
+}
+
+void DMD::shiftRect(int x1, int y1, int x2, int y2, int amountX, int amountY)
+{
+    int width = DMD_PIXELS_ACROSS * DisplaysWide;
+    int height = DMD_PIXELS_DOWN * DisplaysHigh;
+    int rowBytes = DisplaysWide * 4;
+    if (x1 < 0)
+        x1 = 0;
+    if (y1 < 0)
+        y1 = 0;
+    if (x2 >= width)
+        x2 = width - 1;
+    if (y2 >= height)
+        y2 = height - 1;
+    if (x1 > x2 || y1 > y2)
+        return;
+
+    // columns that receive a pixel from inside the rectangle, the rest are cleared
+    int keepX1 = (amountX > 0) ? x1 + amountX : x1;
+    int keepX2 = (amountX < 0) ? x2 + amountX : x2;
+    int words = DisplaysWide;
+    int wFirst = x1 / 32;
+    int wLast = x2 / 32;
+
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
     {
-        // Shift entire screen one bit
-        for (int i = 0; i < DMD_RAM_SIZE_BYTES * DisplaysTotal; i++)
+        byte *ram = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal;
+#define DMD_ROW(y) (ram + ((y) % DMD_PIXELS_DOWN) * (DisplaysTotal << 2) + ((y) / DMD_PIXELS_DOWN) * rowBytes)
+        // walk rows and words away from the direction of travel, so every source is read before it is written
+        for (int n = 0; n <= y2 - y1; n++)
         {
-            if ((i % (DisplaysWide * 4)) == (DisplaysWide * 4) - 1)
-            {
-                bDMDScreenRAM[i] = (bDMDScreenRAM[i] << 1) + 1;
-            }
-            else
+            int y = (amountY > 0) ? y2 - n : y1 + n;
+            int srcY = y - amountY;
+            byte *row = DMD_ROW(y);
+            const byte *src = (srcY >= y1 && srcY <= y2) ? DMD_ROW(srcY) : NULL;
+            for (int k = 0; k <= wLast - wFirst; k++)
             {
-                bDMDScreenRAM[i] = (bDMDScreenRAM[i] << 1) + ((bDMDScreenRAM[i + 1] & 0x80) >> 7);
+                int w = (amountX > 0) ? wLast - k : wFirst + k;
+                uint32_t rectMask = columnMask(w, x1, x2);
+                uint32_t keepMask = (src != NULL) ? columnMask(w, keepX1, keepX2) : 0;
+                uint32_t word = loadPanelWord(row + w * 4) | rectMask;
+                if (keepMask)
+                    word &= stripWindow(src, words, w * 32 - amountX) | ~keepMask;
+                storePanelWord(row + w * 4, word);
             }
         }
+#undef DMD_ROW
+    }
+    markDirty(x1, y1, x2, y2);
+}
+
+void DMD::fillRect(int x1, int y1, int x2, int y2, byte bGraphicsMode)
+{
+    int rowBytes = DisplaysWide * 4;
+    if (x1 < clipX1)
+        x1 = clipX1;
+    if (y1 < clipY1)
+        y1 = clipY1;
+    if (x2 > clipX2)
+        x2 = clipX2;
+    if (y2 > clipY2)
+        y2 = clipY2;
+    if (x1 > x2 || y1 > y2 || bGraphicsMode == GRAPHICS_AND)
+        return;
+
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+    {
+        // what writeRamPixel does to a lit pixel in this plane: light, clear or flip its bit
+        boolean inIntensity = ((bIntensity >> plane) & 1) != 0;
+        boolean light = inIntensity && (bGraphicsMode == GRAPHICS_NORMAL || bGraphicsMode == GRAPHICS_OR);
+        boolean flip = inIntensity && bGraphicsMode == GRAPHICS_TOGGLE;
+        if (!inIntensity && (bGraphicsMode == GRAPHICS_TOGGLE || bGraphicsMode == GRAPHICS_OR))
+            continue;
 
-        // Redraw last char on screen
-        int strWidth = marqueeOffsetX;
-        for (byte i = 0; i < marqueeLength; i++)
+        byte *ram = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal;
+        for (int y = y1; y <= y2; y++)
         {
-            int wide = charWidth(marqueeText[i]);
-            if (strWidth + wide >= DisplaysWide * DMD_PIXELS_ACROSS)
-            {
-                drawChar(strWidth, marqueeOffsetY, marqueeText[i], GRAPHICS_NORMAL);
-                return ret;
-            }
-            strWidth += wide;
-            if (!marqueeNoSpacing)
+            byte *row = ram + (y % DMD_PIXELS_DOWN) * (DisplaysTotal << 2) + (y / DMD_PIXELS_DOWN) * rowBytes;
+            for (int w = x1 / 32; w <= x2 / 32; w++)
             {
-                strWidth += 1;
+                uint32_t mask = columnMask(w, x1, x2);
+                uint32_t word = loadPanelWord(row + w * 4);
+                if (flip)
+                    word ^= mask;
+                else if (light)
+                    word &= ~mask; // zero bit is pixel on
+                else
+                    word |= mask;
+                storePanelWord(row + w * 4, word);
             }
         }
     }
-    else if (amountY == 0 && amountX == 1)
+    markDirty(x1, y1, x2, y2);
+}
+
+/*--------------------------------------------------------------------------------------
+ Marquee strip. The text is laid out as drawString/drawStringCompact would draw it on a
+ clear screen, glyph bits cleared (lit) in a strip that is otherwise all set (unlit). Every
+ step then builds each panel word of the marquee rows from two strip words.
+--------------------------------------------------------------------------------------*/
+// Column j of a glyph width columns wide, row r of the glyph in bit r. Font columns are
+// vertical bytes, the last byte of a multi byte column bottom aligned onto the glyph height
+static inline uint64_t glyphColumnBits(const uint8_t *glyph, int j, int width, uint8_t height)
+{
+    uint8_t bytes = (height + 7) / 8;
+    uint64_t colBits = 0;
+    for (uint8_t i = 0; i < bytes; i++)
     {
-        // Shift entire screen one bit
-        for (int i = (DMD_RAM_SIZE_BYTES * DisplaysTotal) - 1; i >= 0; i--)
+        uint8_t data = pgm_read_byte(glyph + j + (i * width));
+        if ((i == bytes - 1) && bytes > 1)
         {
-            if ((i % (DisplaysWide * 4)) == 0)
-            {
-                bDMDScreenRAM[i] = (bDMDScreenRAM[i] >> 1) + 128;
-            }
-            else
-            {
-                bDMDScreenRAM[i] = (bDMDScreenRAM[i] >> 1) + ((bDMDScreenRAM[i - 1] & 1) << 7);
-            }
+            // bottom aligned, drop the rows already covered by the byte above
+            data >>= (i * 8) - (height - 8);
         }
+        colBits |= (uint64_t)data << (i * 8);
+    }
+    return colBits;
+}
 
-        // Redraw last char on screen
-        int strWidth = marqueeOffsetX;
-        for (byte i = 0; i < marqueeLength; i++)
-        {
-            int wide = charWidth(marqueeText[i]);
-            if (strWidth + wide >= 0)
-            {
-                drawChar(strWidth, marqueeOffsetY, marqueeText[i], GRAPHICS_NORMAL);
-                return ret;
-            }
-            strWidth += wide;
-            if (!marqueeNoSpacing)
-            {
-                strWidth += 1;
-            }
-        }
+void DMD::renderMarqueeStrip()
+{
+    free(marqueeStrip);
+    marqueeStrip = NULL;
+    if (!bMarqueeStrip || this->Font.getFont() == NULL)
+        return;
+
+    uint8_t height = this->Font.getHeight();
+    uint8_t bytes = this->Font.getBytesPerColumn();
+    int columns = 1;
+    for (unsigned int i = 0; i < marqueeLength; i++)
+    {
+        unsigned char c = marqueeText[i];
+        int wide = (c == ' ') ? charWidth(' ') : ((this->Font.getGlyph(c) != NULL) ? this->Font.getWidth(c) : 0);
+        if (wide > 0)
+            columns += wide + (marqueeNoSpacing ? 0 : 1);
     }
-    else
+
+    marqueeStripWords = (columns + 31) / 32;
+    marqueeStripRows = height + 1;
+    int rowBytes = marqueeStripWords * 4;
+    marqueeStrip = (byte *)malloc(rowBytes * marqueeStripRows);
+    if (marqueeStrip == NULL)
+        return;
+    memset(marqueeStrip, 0xFF, rowBytes * marqueeStripRows);
+
+    int rows = (bytes == 1) ? ((height < 8) ? height + 1 : 8) : height;
+    int x = 1;
+    for (unsigned int i = 0; i < marqueeLength; i++)
     {
-        if (marqueeNoSpacing)
+        unsigned char c = marqueeText[i];
+        int wide;
+        if (c == ' ')
         {
-            drawStringCompact(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-                              GRAPHICS_NORMAL);
+            wide = charWidth(' ');
         }
         else
         {
-            drawString(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-                       GRAPHICS_NORMAL);
+            const uint8_t *glyph = this->Font.getGlyph(c);
+            if (glyph == NULL)
+                continue;
+            wide = this->Font.getWidth(c);
+            for (int j = 0; j < wide; j++)
+            {
+                uint64_t colBits = glyphColumnBits(glyph, j, wide, height);
+                byte *ptr = marqueeStrip + ((x + j) >> 3);
+                byte lookup = bPixelLookupTable[(x + j) & 0x07];
+                for (int r = 0; r < rows; r++, ptr += rowBytes)
+                {
+                    if ((colBits >> r) & 1)
+                        *ptr &= ~lookup; // zero bit is pixel on
+                }
+            }
         }
+        if (wide > 0)
+            x += wide + (marqueeNoSpacing ? 0 : 1);
     }
+}
 
-    return ret;
+void DMD::blitMarqueeStrip(int oldTop)
+{
+    int width = DMD_PIXELS_ACROSS * DisplaysWide;
+    int height = DMD_PIXELS_DOWN * DisplaysHigh;
+    int rowBytes = DisplaysWide * 4;
+    int left = marqueeOffsetX - 1;
+    int top = marqueeOffsetY;
+    int y1 = (oldTop < top) ? oldTop : top;
+    int y2 = ((oldTop > top) ? oldTop : top) + marqueeStripRows - 1;
+    if (y1 < 0)
+        y1 = 0;
+    if (y2 > height - 1)
+        y2 = height - 1;
+
+    for (int y = y1; y <= y2; y++)
+    {
+        int r = y - top;
+        boolean inStrip = (r >= 0 && r < marqueeStripRows);
+        // rows of the old band only are cleared, rows in neither are left alone
+        if (!inStrip && (y < oldTop || y >= oldTop + marqueeStripRows))
+            continue;
+        const byte *stripRow = marqueeStrip + r * marqueeStripWords * 4;
+
+        for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+        {
+            byte *row = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal +
+                        (y % DMD_PIXELS_DOWN) * (DisplaysTotal << 2) + (y / DMD_PIXELS_DOWN) * rowBytes;
+            boolean lit = inStrip && ((bIntensity >> plane) & 1);
+            for (int w = 0; w < DisplaysWide; w++)
+                storePanelWord(row + w * 4, lit ? stripWindow(stripRow, marqueeStripWords, w * 32 - left) : 0xFFFFFFFF);
+        }
+    }
+    if (y1 <= y2)
+        markDirty(0, y1, width - 1, y2);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -695,6 +1206,7 @@ void DMD::clearScreen(byte bNormal)
         memset(bDMDScreenRAM, 0xFF, DMD_RAM_SIZE_BYTES * DisplaysTotal);
     else // set all pixels
         memset(bDMDScreenRAM, 0x00, DMD_RAM_SIZE_BYTES * DisplaysTotal);
+    markDirty(0, 0, DMD_PIXELS_ACROSS * DisplaysWide - 1, DMD_PIXELS_DOWN * DisplaysHigh - 1);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -884,22 +1396,57 @@ void DMD::drawTestPattern(byte bPattern)
  Call 4 times to scan the whole display which is made up of 4 interleaved rows within the 16 total rows.
  Insert the calls to this function into the main loop for the highest call rate, or from a timer interrupt
 --------------------------------------------------------------------------------------*/
-void DMD::scanDisplayBySPI()
+void IRAM_ATTR DMD::scanDisplayBySPI()
 {
+    // binary code modulation: bit plane n of a scan line stays lit for 2^n calls
+    if (bPlaneHold > 0)
+    {
+        bPlaneHold--;
+        return;
+    }
+
     // if PIN_OTHER_SPI_nCS is in use during a DMD scan request then scanDisplayBySPI() will exit without conflict! (and skip that scan)
     if (digitalRead(PIN_OTHER_SPI_nCS) == HIGH)
     {
+        // a swapped in back buffer is only shown from the start of a scan pass
+        // (read once, swapBuffers may withdraw it meanwhile)
+        byte *pending = bDMDPendingRAM;
+        if (bDMDByte == 0 && bDMDPlane == 0 && pending != NULL)
+        {
+            bDMDFrontRAM = pending;
+            bDMDPendingRAM = NULL;
+            for (byte i = 0; i < 4; i++)
+                bStageDirty[i] = true;
+        }
+
         // SPI transfer pixels to the display hardware shift registers
         int rowsize = DisplaysTotal << 2;
-        int offset = rowsize * bDMDByte;
-        for (int i = 0; i < rowsize; i++)
+        int plane = bDMDPlane * DMD_PLANE_SIZE_BYTES * DisplaysTotal;
+        const byte *front = bDMDFrontRAM + plane;
+        if (bScanMode == SCAN_MODE_BURST)
         {
-            vspi->beginTransaction(SPISettings(spiClk, MSBFIRST, SPI_MODE0));
-            vspi->transfer(bDMDScreenRAM[offset + i + row3]);
-            vspi->transfer(bDMDScreenRAM[offset + i + row2]);
-            vspi->transfer(bDMDScreenRAM[offset + i + row1]);
-            vspi->transfer(bDMDScreenRAM[offset + i]);
-            vspi->endTransaction();
+            // whole scan line as one transaction, restaged only if one of its rows changed
+            if (bDMDPlane == 0 && bStageDirty[bDMDByte])
+            {
+                bStageDirty[bDMDByte] = false;
+                stageScanLine(bDMDByte);
+            }
+            spiBus->beginTransaction();
+            spiBus->writeBytes(bDMDScanRAM + plane + (rowsize << 2) * bDMDByte, rowsize << 2);
+            spiBus->endTransaction();
+        }
+        else
+        {
+            int offset = rowsize * bDMDByte;
+            for (int i = 0; i < rowsize; i++)
+            {
+                spiBus->beginTransaction();
+                spiBus->transfer(front[offset + i + row3]);
+                spiBus->transfer(front[offset + i + row2]);
+                spiBus->transfer(front[offset + i + row1]);
+                spiBus->transfer(front[offset + i]);
+                spiBus->endTransaction();
+            }
         }
 
         oeRowsOff();
@@ -908,101 +1455,445 @@ void DMD::scanDisplayBySPI()
         {
         case 0: // row 1, 5, 9, 13 were clocked out
             lightRow_01_05_09_13();
-            bDMDByte = 1;
             break;
         case 1: // row 2, 6, 10, 14 were clocked out
             lightRow_02_06_10_14();
-            bDMDByte = 2;
             break;
         case 2: // row 3, 7, 11, 15 were clocked out
             lightRow_03_07_11_15();
-            bDMDByte = 3;
             break;
         case 3: // row 4, 8, 12, 16 were clocked out
             lightRow_04_08_12_16();
-            bDMDByte = 0;
             break;
         }
         oeRowsOn();
+
+        // next bit plane, or the first plane of the next scan line
+        bPlaneHold = dmdPlaneTicks(bDMDPlane) - 1;
+        if (++bDMDPlane == DMD_BITSPERPIXEL)
+        {
+            bDMDPlane = 0;
+            bDMDByte = (bDMDByte + 1) & 0x03;
+        }
     }
 }
 
-void DMD::selectFont(const uint8_t *font)
+/*--------------------------------------------------------------------------------------
+ Timer driven scanning. Each timer tick is one scanDisplayBySPI call, so a full refresh
+ takes 4 ticks, or 4 * (2^DMD_BITSPERPIXEL - 1) ticks with binary code modulation.
+ A scan that takes longer than the period, or a tick that arrives a period or more late,
+ counts as a missed deadline.
+--------------------------------------------------------------------------------------*/
+boolean DMD::beginScanning(uint16_t refreshHz)
 {
-    this->Font = font;
+    endScanning();
+    if (scanTimer == NULL)
+        scanTimer = new DMDHwScanTimer();
+
+    scanPeriodUs = dmdScanPeriodUs(refreshHz, DisplaysTotal, spiClk, DMD_BITSPERPIXEL);
+    scanDurationUs = 0;
+    maxScanDurationUs = 0;
+    missedDeadlines = 0;
+    lastScanStartUs = scanTimer->micros();
+    bScanning = scanTimer->start(scanPeriodUs, scanTimerCallback, this);
+    return bScanning;
 }
 
-int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode)
+void DMD::endScanning()
 {
-    if (bX > (DMD_PIXELS_ACROSS * DisplaysWide) || bY > (DMD_PIXELS_DOWN * DisplaysHigh))
-        return -1;
-    unsigned char c = letter;
-    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
-    if (c == ' ')
+    if (!bScanning)
+        return;
+    scanTimer->stop();
+    bScanning = false;
+}
+
+void DMD::setScanTimer(DMDScanTimer *timer)
+{
+    endScanning();
+    scanTimer = timer;
+}
+
+void IRAM_ATTR DMD::scanTimerCallback(void *arg)
+{
+    ((DMD *)arg)->scanTick();
+}
+
+void IRAM_ATTR DMD::scanTick()
+{
+    uint32_t start = scanTimer->micros();
+    uint32_t sinceLast = start - lastScanStartUs;
+    if (sinceLast >= 2 * scanPeriodUs)
+        missedDeadlines += sinceLast / scanPeriodUs - 1;
+    lastScanStartUs = start;
+
+    scanDisplayBySPI();
+
+    uint32_t duration = scanTimer->micros() - start;
+    scanDurationUs = duration;
+    if (duration > maxScanDurationUs)
+        maxScanDurationUs = duration;
+    if (duration > scanPeriodUs)
+        missedDeadlines++;
+}
+
+uint32_t DMD::getScanPeriodUs()
+{
+    return scanPeriodUs;
+}
+
+uint32_t DMD::getScanDurationUs()
+{
+    return scanDurationUs;
+}
+
+uint32_t DMD::getMaxScanDurationUs()
+{
+    return maxScanDurationUs;
+}
+
+uint32_t DMD::getMissedDeadlines()
+{
+    return missedDeadlines;
+}
+
+/*--------------------------------------------------------------------------------------
+ Interleave one scan line into the staging buffer in the order the panel shift registers
+ expect it: for every column byte the rows 13-16, 9-12, 5-8 and 1-4 of that scan line
+--------------------------------------------------------------------------------------*/
+void IRAM_ATTR DMD::stageScanLine(byte bScanLine)
+{
+    int rowsize = DisplaysTotal << 2;
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
     {
-        int charWide = charWidth(' ');
-        this->drawFilledBox(bX, bY, bX + charWide, bY + height, GRAPHICS_INVERSE);
-        return charWide;
+        const byte *src = bDMDFrontRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal + rowsize * bScanLine;
+        byte *dst = bDMDScanRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal + (rowsize << 2) * bScanLine;
+        for (int i = 0; i < rowsize; i++)
+        {
+            *dst++ = src[i + row3];
+            *dst++ = src[i + row2];
+            *dst++ = src[i + row1];
+            *dst++ = src[i];
+        }
     }
-    uint8_t width = 0;
-    uint8_t bytes = (height + 7) / 8;
+}
 
-    uint8_t firstChar = pgm_read_byte(this->Font + FONT_FIRST_CHAR);
-    uint8_t charCount = pgm_read_byte(this->Font + FONT_CHAR_COUNT);
+void DMD::setScanMode(byte bScanMode)
+{
+    for (byte i = 0; i < 4; i++)
+        bStageDirty[i] = true;
+    this->bScanMode = bScanMode;
+}
 
-    uint16_t index = 0;
+/*--------------------------------------------------------------------------------------
+ Brightness. At full brightness nOE is a plain GPIO as before, below it the pin is
+ handed to an LEDC PWM channel running at the brightness duty, set here and never from
+ the scan. oeRowsOff/oeRowsOn route the pin to its GPIO output, left LOW, around each
+ latch and back to the channel once the next rows are selected.
+--------------------------------------------------------------------------------------*/
+void DMD::setBrightness(byte bBrightness)
+{
+    uint32_t duty = dmdBrightnessDuty(bBrightness, DMD_PWM_RESOLUTION);
+    this->bBrightness = bBrightness;
+    if (duty >= (1UL << DMD_PWM_RESOLUTION) - 1)
+    {
+        if (bPwmAttached)
+        {
+            bPwmAttached = false;
+            ledcDetach(_nOEPin);
+            pinMode(_nOEPin, OUTPUT);
+            digitalWrite(_nOEPin, LOW);
+        }
+        return;
+    }
 
-    if (c < firstChar || c >= (firstChar + charCount))
-        return 0;
-    c -= firstChar;
+    if (!bPwmAttached)
+    {
+        // the GPIO level the pin shows while the scan blanks it
+        digitalWrite(_nOEPin, LOW);
+        if (!ledcAttach(_nOEPin, DMD_PWM_FREQUENCY, DMD_PWM_RESOLUTION))
+            return;
+        ledc_channel_handle_t *channel = (ledc_channel_handle_t *)perimanGetPinBus(_nOEPin, ESP32_BUS_TYPE_LEDC);
+        if (channel == NULL)
+        {
+            ledcDetach(_nOEPin);
+            pinMode(_nOEPin, OUTPUT);
+            return;
+        }
+        // arduino-esp32 numbers the channels of the speed modes on, high speed first where there is one
+#if SOC_LEDC_SUPPORT_HS_MODE
+        oeSignal = ((channel->channel < 8) ? LEDC_HS_SIG_OUT0_IDX : LEDC_LS_SIG_OUT0_IDX) + channel->channel % 8;
+#else
+        oeSignal = LEDC_LS_SIG_OUT0_IDX + channel->channel % 8;
+#endif
+    }
+    ledcWrite(_nOEPin, duty);
+    bPwmAttached = true;
+}
+
+byte DMD::getBrightness()
+{
+    return bBrightness;
+}
+
+/*--------------------------------------------------------------------------------------
+ Dirty tracking. Marks are made after DMD RAM is written, so a scan that clears a
+ bStageDirty flag while drawing is in progress is followed by another mark.
+ When double buffered, the scan restages every line after picking up a new frame.
+--------------------------------------------------------------------------------------*/
+void DMD::markDirty(int x1, int y1, int x2, int y2)
+{
+    for (int y = y1; y <= y2; y++)
+    {
+        if (x1 < dirtyMinX[y])
+            dirtyMinX[y] = x1;
+        if (x2 > dirtyMaxX[y])
+            dirtyMaxX[y] = x2;
+    }
+    // a scan line carries every 4th pixel row
+    if (!bDoubleBuffered)
+    {
+        for (int y = y1; y <= y2 && y < y1 + 4; y++)
+            bStageDirty[y & 0x03] = true;
+    }
+}
+
+boolean DMD::isDirty()
+{
+    int x1, y1, x2, y2;
+    return getDirtyRect(x1, y1, x2, y2);
+}
+
+boolean DMD::getDirtyRow(int bY, int &x1, int &x2)
+{
+    if (bY < 0 || bY >= DMD_PIXELS_DOWN * DisplaysHigh || dirtyMinX[bY] > dirtyMaxX[bY])
+        return false;
+    x1 = dirtyMinX[bY];
+    x2 = dirtyMaxX[bY];
+    return true;
+}
+
+boolean DMD::getDirtyRect(int &x1, int &y1, int &x2, int &y2)
+{
+    boolean dirty = false;
+    for (int y = 0; y < DMD_PIXELS_DOWN * DisplaysHigh; y++)
+    {
+        if (dirtyMinX[y] > dirtyMaxX[y])
+            continue;
+        if (!dirty)
+        {
+            x1 = dirtyMinX[y];
+            x2 = dirtyMaxX[y];
+            y1 = y;
+            dirty = true;
+        }
+        if (dirtyMinX[y] < x1)
+            x1 = dirtyMinX[y];
+        if (dirtyMaxX[y] > x2)
+            x2 = dirtyMaxX[y];
+        y2 = y;
+    }
+    return dirty;
+}
 
-    if (pgm_read_byte(this->Font + FONT_LENGTH) == 0 && pgm_read_byte(this->Font + FONT_LENGTH + 1) == 0)
+void DMD::clearDirty()
+{
+    for (int y = 0; y < DMD_PIXELS_DOWN * DisplaysHigh; y++)
+    {
+        dirtyMinX[y] = INT16_MAX;
+        dirtyMaxX[y] = -1;
+    }
+}
+
+void DMD::setSpiBus(DMDSpiBus *bus)
+{
+    if (bus == NULL || bus == spiBus)
+        return;
+    // no scan may be using the old bus while it goes
+    boolean scanning = bScanning;
+    endScanning();
+    if (bOwnsSpiBus)
+        delete spiBus;
+    bOwnsSpiBus = false;
+    spiBus = bus;
+    spiBus->begin(_clkPin, _rDataPin);
+    if (scanning)
+        bScanning = scanTimer->start(scanPeriodUs, scanTimerCallback, this);
+}
+
+/*--------------------------------------------------------------------------------------
+ Double buffering: drawing goes to bDMDScreenRAM, the scan reads bDMDFrontRAM. swapBuffers
+ hands the finished frame to the scan and waits for it to be picked up at scan line 0
+ before drawing is allowed into the previous front buffer. The wait is bounded, and with no
+ scan timer running there is nothing to wait for.
+--------------------------------------------------------------------------------------*/
+void DMD::enableDoubleBuffer(boolean bCopyOnSwap)
+{
+    this->bCopyOnSwap = bCopyOnSwap;
+    if (bDoubleBuffered)
+        return;
+
+    byte *back = (byte *)malloc(DisplaysTotal * DMD_RAM_SIZE_BYTES);
+    if (back == NULL)
+        return;
+    memcpy(back, bDMDScreenRAM, DisplaysTotal * DMD_RAM_SIZE_BYTES);
+    bDMDScreenRAM = back;
+    bDoubleBuffered = true;
+}
+
+boolean DMD::swapBuffers()
+{
+    if (!bDoubleBuffered)
+        return true;
+
+    byte *shown = bDMDFrontRAM;
+    if (!bScanning)
     {
-        // zero length is flag indicating fixed width font (array does not contain width data entries)
-        width = pgm_read_byte(this->Font + FONT_FIXED_WIDTH);
-        index = c * bytes * width + FONT_WIDTH_TABLE;
+        // no interrupt can be inside a scan, the next scanDisplayBySPI restages from the new frame
+        bDMDFrontRAM = bDMDScreenRAM;
+        for (byte i = 0; i < 4; i++)
+            bStageDirty[i] = true;
     }
     else
     {
-        // variable width font, read width data, to get the index
-        for (uint8_t i = 0; i < c; i++)
+        bDMDPendingRAM = bDMDScreenRAM;
+        uint32_t timeoutUs = 2 * 4 * dmdLineTicks(DMD_BITSPERPIXEL) * scanPeriodUs;
+        uint32_t start = scanTimer->micros();
+        while (bDMDPendingRAM != NULL && scanTimer->micros() - start < timeoutUs)
         {
-            index += pgm_read_byte(this->Font + FONT_WIDTH_TABLE + i);
+            // wait for the scan to reach line 0
         }
-        index = index * bytes + charCount + FONT_WIDTH_TABLE;
-        width = pgm_read_byte(this->Font + FONT_WIDTH_TABLE + c);
+        // take the frame back unless the scan has it, the scan interrupt either ran before this
+        // or will find nothing pending
+        bDMDPendingRAM = NULL;
+        if (bDMDFrontRAM != bDMDScreenRAM)
+            return false;
+    }
+    bDMDScreenRAM = shown;
+    if (bCopyOnSwap)
+        memcpy(bDMDScreenRAM, bDMDFrontRAM, DisplaysTotal * DMD_RAM_SIZE_BYTES);
+    return true;
+}
+
+void DMD::selectFont(const uint8_t *font)
+{
+    this->Font.attach(font);
+}
+
+int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode)
+{
+    return drawChar(bX, bY, letter, bGraphicsMode, this->Font);
+}
+
+int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode, DMDFont &font)
+{
+    if (bX > (DMD_PIXELS_ACROSS * DisplaysWide) || bY > (DMD_PIXELS_DOWN * DisplaysHigh))
+        return -1;
+    unsigned char c = letter;
+    uint8_t height = font.getHeight();
+    if (c == ' ')
+    {
+        int charWide = charWidthOfFont(' ', font);
+        blitColumns(bX, bY, NULL, charWide + 1, height, height + 1, GRAPHICS_INVERSE);
+        return charWide;
     }
+    uint8_t bytes = font.getBytesPerColumn();
+    const uint8_t *glyph = font.getGlyph(c);
+    if (glyph == NULL)
+        return 0;
+    uint8_t width = font.getWidth(c);
     if (bX < -width || bY < -height)
         return width;
 
     // last but not least, draw the character
-    for (uint8_t j = 0; j < width; j++)
-    { // Width
-        for (uint8_t i = bytes - 1; i < 254; i--)
-        { // Vertical Bytes
-            uint8_t data = pgm_read_byte(this->Font + index + j + (i * width));
-            int offset = (i * 8);
-            if ((i == bytes - 1) && bytes > 1)
+    // single byte fonts also cover the row just below the glyph (bit 7 for 7 pixel fonts)
+    int rows = (bytes == 1) ? ((height < 8) ? height + 1 : 8) : height;
+    blitColumns(bX, bY, glyph, width, height, rows, bGraphicsMode);
+    return width;
+}
+
+/*--------------------------------------------------------------------------------------
+ Blit a glyph into DMD RAM one column at a time. The clip against the panel grid is done
+ once per glyph, the destination byte and bit mask once per column, and the graphics mode
+ is reduced to and/or/xor masks so the row loop only picks the lit or unlit set.
+ Font columns are stored as vertical bytes (bit 0 at the top), with the last byte of a
+ multi byte column bottom aligned onto the glyph height. A NULL glyph is a solid block.
+--------------------------------------------------------------------------------------*/
+// Per mode action on the destination bit for {unlit, lit} glyph bits
+#define BLIT_CLEAR 0x01  // zero bit is pixel on
+#define BLIT_SET 0x02    // one bit is pixel off
+#define BLIT_TOGGLE 0x04
+static const byte bBlitActions[6][2] =
+    {
+        {BLIT_SET, BLIT_CLEAR}, // GRAPHICS_NORMAL
+        {BLIT_CLEAR, BLIT_SET}, // GRAPHICS_INVERSE
+        {0, BLIT_TOGGLE},       // GRAPHICS_TOGGLE
+        {0, BLIT_CLEAR},        // GRAPHICS_OR
+        {0, BLIT_SET},          // GRAPHICS_NOR
+        {BLIT_SET, 0}           // GRAPHICS_AND
+};
+// Same for bit planes that are not part of the drawing intensity, lit pixels stay off there
+static const byte bDarkBlitActions[6][2] =
+    {
+        {BLIT_SET, BLIT_SET}, // GRAPHICS_NORMAL
+        {BLIT_SET, BLIT_SET}, // GRAPHICS_INVERSE
+        {0, 0},               // GRAPHICS_TOGGLE
+        {0, 0},               // GRAPHICS_OR
+        {0, BLIT_SET},        // GRAPHICS_NOR
+        {BLIT_SET, 0}         // GRAPHICS_AND
+};
+
+void DMD::blitColumns(int bX, int bY, const uint8_t *glyph, int width, uint8_t height, int rows, byte bGraphicsMode)
+{
+    if (bGraphicsMode > GRAPHICS_AND)
+        return;
+
+    int jStart = (bX < clipX1) ? clipX1 - bX : 0;
+    int jEnd = (bX + width > clipX2 + 1) ? clipX2 + 1 - bX : width;
+    int rStart = (bY < clipY1) ? clipY1 - bY : 0;
+    int rEnd = (bY + rows > clipY2 + 1) ? clipY2 + 1 - bY : rows;
+    if (jStart >= jEnd || rStart >= rEnd)
+        return;
+
+    int stride = DisplaysTotal << 2;     // bytes between pixel rows of one panel
+    int panelRow = DisplaysWide << 2;    // bytes between the same row of vertically adjacent panels
+    int yStart = bY + rStart;
+    int rowStart = panelRow * (yStart / DMD_PIXELS_DOWN) + (yStart % DMD_PIXELS_DOWN) * stride;
+
+    for (int j = jStart; j < jEnd; j++)
+    {
+        int x = bX + j;
+        byte lookup = bPixelLookupTable[x & 0x07];
+
+        uint64_t colBits = (glyph != NULL) ? glyphColumnBits(glyph, j, width, height) : ~(uint64_t)0;
+
+        for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+        {
+            const byte *actions = ((bIntensity >> plane) & 1) ? bBlitActions[bGraphicsMode] : bDarkBlitActions[bGraphicsMode];
+            byte andMask[2], orMask[2], xorMask[2];
+            for (byte lit = 0; lit < 2; lit++)
             {
-                offset = height - 8;
+                andMask[lit] = (actions[lit] & BLIT_CLEAR) ? ~lookup : 0xFF;
+                orMask[lit] = (actions[lit] & BLIT_SET) ? lookup : 0;
+                xorMask[lit] = (actions[lit] & BLIT_TOGGLE) ? lookup : 0;
             }
-            for (uint8_t k = 0; k < 8; k++)
-            { // Vertical bits
-                if ((offset + k >= i * 8) && (offset + k <= height))
-                {
-                    if (data & (1 << k))
-                    {
-                        writePixel(bX + j, bY + offset + k, bGraphicsMode, true);
-                    }
-                    else
-                    {
-                        writePixel(bX + j, bY + offset + k, bGraphicsMode, false);
-                    }
-                }
+
+            byte *ptr = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal + rowStart + (x >> 3);
+            int y = yStart;
+            for (int r = rStart; r < rEnd; r++)
+            {
+                byte lit = (colBits >> r) & 1;
+                *ptr = ((*ptr & andMask[lit]) | orMask[lit]) ^ xorMask[lit];
+
+                // step down a row, wrapping onto the panel below every DMD_PIXELS_DOWN rows
+                y++;
+                if ((y % DMD_PIXELS_DOWN) == 0)
+                    ptr += panelRow - (DMD_PIXELS_DOWN - 1) * stride;
+                else
+                    ptr += stride;
             }
         }
     }
-    return width;
+    markDirty(bX + jStart, bY + rStart, bX + jEnd - 1, bY + rEnd - 1);
 }
 
 int DMD::charWidth(const unsigned char letter)
@@ -1010,19 +1901,125 @@ int DMD::charWidth(const unsigned char letter)
     return charWidthOfFont(letter, this->Font);
 }
 
-void DMD::drawContainer(DMDContainer *container)
+int DMD::charWidth(const unsigned char letter, DMDFont &font)
+{
+    return charWidthOfFont(letter, font);
+}
+
+void DMD::setClip(int x1, int y1, int x2, int y2)
+{
+    clipX1 = (x1 < 0) ? 0 : x1;
+    clipY1 = (y1 < 0) ? 0 : y1;
+    clipX2 = (x2 >= DMD_PIXELS_ACROSS * DisplaysWide) ? DMD_PIXELS_ACROSS * DisplaysWide - 1 : x2;
+    clipY2 = (y2 >= DMD_PIXELS_DOWN * DisplaysHigh) ? DMD_PIXELS_DOWN * DisplaysHigh - 1 : y2;
+}
+
+void DMD::clearClip()
+{
+    setClip(0, 0, DMD_PIXELS_ACROSS * DisplaysWide - 1, DMD_PIXELS_DOWN * DisplaysHigh - 1);
+}
+
+void DMD::getClip(int &x1, int &y1, int &x2, int &y2)
+{
+    x1 = clipX1;
+    y1 = clipY1;
+    x2 = clipX2;
+    y2 = clipY2;
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw a container. Its rows are packed like DMD RAM, so every panel word of a row is built
+ from a window of two canvas words at the scroll offset, and the graphics mode applied to the
+ lit and unlit bits of the word with the same actions blitColumns uses for glyph bits.
+--------------------------------------------------------------------------------------*/
+// 32 bits of a canvas row starting at any bit, bits right of the canvas width unlit
+static inline uint32_t canvasStrip(const byte *row, int words, int canvasW, int bit)
+{
+    int inside = canvasW - bit;
+    if (inside <= 0)
+        return 0xFFFFFFFF;
+    uint32_t bits = stripWindow(row, words, bit);
+    return (inside >= 32) ? bits : bits | (0xFFFFFFFF >> inside);
+}
+
+// As canvasStrip, repeating the canvas every canvasW bits when wrapping
+static inline uint32_t canvasWindow(const byte *row, int words, int canvasW, int bit, boolean wrap)
+{
+    if (!wrap)
+        return canvasStrip(row, words, canvasW, bit);
+    bit %= canvasW;
+    if (bit < 0)
+        bit += canvasW;
+    // each copy of the canvas row is unlit outside itself, so the copies combine by and
+    uint32_t bits = 0xFFFFFFFF;
+    for (; bit > -32; bit -= canvasW)
+        bits &= canvasStrip(row, words, canvasW, bit);
+    return bits;
+}
+
+static inline uint32_t applyBlitAction(uint32_t word, byte action, uint32_t mask)
+{
+    if (action & BLIT_CLEAR)
+        word &= ~mask;
+    if (action & BLIT_SET)
+        word |= mask;
+    if (action & BLIT_TOGGLE)
+        word ^= mask;
+    return word;
+}
+
+void DMD::drawContainer(DMDContainer *container, byte bGraphicsMode)
 {
-    int16_t x0 = container->getX0();
-    int16_t y0 = container->getY0();
-    int16_t w = container->getW();
-    int16_t h = container->getH();
-    uint8_t* buf = container->getBufferData();
+    const uint8_t *buf = container->getBufferData();
+    if (buf == NULL || bGraphicsMode > GRAPHICS_AND)
+        return;
+
+    int rowBytes = DisplaysWide * 4;
+    int left = container->getX0();
+    int top = container->getY0();
+    int stride = container->getStride();
+    int words = stride / 4;
+    int canvasW = container->getCanvasW();
+    int canvasH = container->getCanvasH();
+    int scrollX = container->getScrollX();
+    int scrollY = container->getScrollY();
+    boolean wrap = container->getWrap();
+    int x1 = (left < clipX1) ? clipX1 : left;
+    int x2 = left + container->getW() - 1;
+    int y1 = (top < clipY1) ? clipY1 : top;
+    int y2 = top + container->getH() - 1;
+    if (x2 > clipX2)
+        x2 = clipX2;
+    if (y2 > clipY2)
+        y2 = clipY2;
+    if (x1 > x2 || y1 > y2)
+        return;
 
-    for (uint16_t i = 0; i < w; i++)
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
     {
-        for (uint16_t j = 0; j < h; j++)
+        byte *ram = bDMDScreenRAM + plane * DMD_PLANE_SIZE_BYTES * DisplaysTotal;
+        const byte *actions = ((bIntensity >> plane) & 1) ? bBlitActions[bGraphicsMode] : bDarkBlitActions[bGraphicsMode];
+        for (int y = y1; y <= y2; y++)
         {
-            writePixel(i + x0 - 1, j + y0, GRAPHICS_NORMAL, buf[j * w + i]);
+            byte *row = ram + (y % DMD_PIXELS_DOWN) * (DisplaysTotal << 2) + (y / DMD_PIXELS_DOWN) * rowBytes;
+            int canvasY = y - top + scrollY;
+            if (wrap)
+            {
+                canvasY %= canvasH;
+                if (canvasY < 0)
+                    canvasY += canvasH;
+            }
+            const byte *src = (canvasY >= 0 && canvasY < canvasH) ? buf + canvasY * stride : NULL;
+            for (int w = x1 / 32; w <= x2 / 32; w++)
+            {
+                uint32_t mask = columnMask(w, x1, x2);
+                uint32_t bits = (src != NULL) ? canvasWindow(src, words, canvasW, w * 32 - left + scrollX, wrap) : 0xFFFFFFFF;
+                uint32_t word = loadPanelWord(row + w * 4);
+                word = applyBlitAction(word, actions[1], ~bits & mask);
+                word = applyBlitAction(word, actions[0], bits & mask);
+                storePanelWord(row + w * 4, word);
+            }
         }
     }
+    markDirty(x1, y1, x2, y2);
 }
@@ -50,7 +50,18 @@ LED Panel Layout in RAM
 // SPI library must be included for the SPI scanning/connection method to the DMD
 #include <SPI.h>
 
+// GPIO matrix routing in ROM, which the scan interrupt can call with the flash cache off
+#include "esp_rom_gpio.h"
+#include "soc/gpio_sig_map.h"
+
 #include "DMDContainer.h"
+#include "DMDFont.h"
+#include "DMDSpiBus.h"
+#include "DMDScanTimer.h"
+#include "DMDBrightness.h"
+#include "DMDTextSource.h"
+#include "DMDScrollClock.h"
+#include "DMDShapeCache.h"
 #include "constants.h"
 
 // ######################################################################################################################
@@ -75,6 +86,17 @@ LED Panel Layout in RAM
 #define GRAPHICS_TOGGLE 2
 #define GRAPHICS_OR 3
 #define GRAPHICS_NOR 4
+#define GRAPHICS_AND 5 // unlit pixels clear, lit pixels leave what is there
+
+// Text alignment in a box (drawStringAligned, drawArabicAligned, alignX)
+#define DMD_ALIGN_LEFT 0
+#define DMD_ALIGN_CENTER 1
+#define DMD_ALIGN_RIGHT 2
+#define DMD_ALIGN_JUSTIFY 3 // spaces widened so the text fills the box
+
+// Scan modes (setScanMode)
+#define SCAN_MODE_BYTEWISE 0 // one bus transaction and four single byte transfers per column byte
+#define SCAN_MODE_BURST 1    // scan line interleaved into a staging buffer, sent as one transaction
 
 // drawTestPattern Patterns
 #define PATTERN_ALT_0 0
@@ -85,9 +107,16 @@ LED Panel Layout in RAM
 // display screen (and subscreen) sizing
 #define DMD_PIXELS_ACROSS 32 // pixels across x axis (base 2 size expected)
 #define DMD_PIXELS_DOWN 16   // pixels down y axis
-#define DMD_BITSPERPIXEL 1   // 1 bit per pixel, use more bits to allow for pwm screen brightness control
+#ifndef DMD_BITSPERPIXEL
+#define DMD_BITSPERPIXEL 1   // 1 bit per pixel, use more bits (up to 4) for grayscale by binary code modulation
+#endif
 #define DMD_RAM_SIZE_BYTES ((DMD_PIXELS_ACROSS * DMD_BITSPERPIXEL / 8) * DMD_PIXELS_DOWN)
 // (32x * 1 / 8) = 4 bytes, * 16y = 64 bytes per screen here.
+// With more bits per pixel DMD RAM holds DMD_BITSPERPIXEL bit planes one after the other, least significant first
+#define DMD_PLANE_SIZE_BYTES ((DMD_PIXELS_ACROSS / 8) * DMD_PIXELS_DOWN)
+#define DMD_MAX_INTENSITY ((1 << DMD_BITSPERPIXEL) - 1)
+// glyphs a streamed marquee remembers to finish drawing as they scroll fully into view
+#define DMD_MARQUEE_RECENT 8
 // lookup table for DMD::writePixel to make the pixel indexing routine faster
 static byte bPixelLookupTable[8] =
     {
@@ -118,39 +147,110 @@ public:
   // Set or clear a pixel at the x and y location (0,0 is the top left corner)
   void writePixel(unsigned int bX, unsigned int bY, byte bGraphicsMode, byte bPixel);
 
+  // Set a pixel to an intensity level, 0 (off) to DMD_MAX_INTENSITY
+  void writePixelLevel(unsigned int bX, unsigned int bY, byte bLevel);
+
+  // Read back the intensity level of a pixel in DMD RAM, 0 (off) to DMD_MAX_INTENSITY
+  byte readPixelLevel(unsigned int bX, unsigned int bY);
+
+  // Size of the whole display in pixels
+  int getWidth();
+  int getHeight();
+
+  // Intensity lit pixels are drawn at by all drawing calls, 0 to DMD_MAX_INTENSITY (default)
+  void setIntensity(byte bLevel);
+
   // Draw a string
-  void drawString(int bX, int bY, const char *bChars, byte length, byte bGraphicsMode);
+  void drawString(int bX, int bY, const char *bChars, unsigned int length, byte bGraphicsMode);
 
   // Draw a string with no extra column spacing between glyphs
-  void drawStringCompact(int bX, int bY, const char *bChars, byte length, byte bGraphicsMode);
+  void drawStringCompact(int bX, int bY, const char *bChars, unsigned int length, byte bGraphicsMode);
 
   // Draw a string right-to-left, anchoring at rightX
-  void drawStringRTL(int rightX, int bY, const char *bChars, byte length, byte bGraphicsMode);
+  void drawStringRTL(int rightX, int bY, const char *bChars, unsigned int length, byte bGraphicsMode);
 
   // Convert UTF-8 Arabic text to DMD Arabic font glyph bytes
-  uint16_t utf8ToArabic(const char *utf8Text, char *outBuffer, uint16_t outBufferSize);
+  unsigned int utf8ToArabic(const char *utf8Text, char *outBuffer, unsigned int outBufferSize);
 
-  // Draw UTF-8 Arabic text (reversed to visual RTL order, then drawn LTR)
+  // Draw UTF-8 Arabic text (put in visual RTL order by DMDBidi, then drawn LTR)
   void drawArabicString(int bX, int bY, const char *utf8Text, byte bGraphicsMode);
 
   // Set up a scrolling Arabic marquee (use stepMarquee to animate)
   void drawArabicMarquee(const char *utf8Text, int left, int top);
 
+  // Width in pixels of text as drawString, drawStringCompact and drawArabicString draw it, from
+  // the first glyph column to the last, without drawing. measureArabic shapes the text without
+  // allocating (or takes the width from the shape cache)
+  int measureString(const char *bChars, unsigned int length);
+  int measureStringCompact(const char *bChars, unsigned int length);
+  int measureArabic(const char *utf8Text);
+
+  // x to draw text width pixels wide at to align it in the columns x1 to x2 (justified text is
+  // placed as left aligned)
+  static int alignX(int width, int x1, int x2, byte align);
+
+  // Draw text aligned in the columns x1 to x2 by a DMD_ALIGN_ value. Text with no spaces, or too
+  // wide for the box, is not justified: drawStringAligned leaves it left aligned and
+  // drawArabicAligned right aligned
+  void drawStringAligned(int x1, int x2, int bY, const char *bChars, unsigned int length, byte align, byte bGraphicsMode);
+  void drawArabicAligned(int x1, int x2, int bY, const char *utf8Text, byte align, byte bGraphicsMode);
+
+  // Take shaped Arabic text for drawArabicString and drawArabicMarquee from cache, shaping
+  // only the text it does not hold yet (NULL, the default, shapes every call)
+  void setShapeCache(DMDShapeCache *cache);
+
   // Select a text font
   void selectFont(const uint8_t *font);
 
   // Draw a single character
   int drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode);
+  int drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode, DMDFont &font);
 
   // Find the width of a character
   int charWidth(const unsigned char letter);
+  int charWidth(const unsigned char letter, DMDFont &font);
+
+  // Keep characters, strings and containers inside the rectangle x1,y1 - x2,y2 until clearClip
+  void setClip(int x1, int y1, int x2, int y2);
+  void clearClip();
+  // The clip rectangle, the whole display when none is set
+  void getClip(int &x1, int &y1, int &x2, int &y2);
 
   // Draw a scrolling string
-  void drawMarquee(const char *bChars, byte length, int left, int top);
+  void drawMarquee(const char *bChars, unsigned int length, int left, int top);
+
+  // Scroll text pulled from source as it comes into view, so it can be of any length or
+  // still being written (see DMDTextSource.h). Text enters at the right edge and is stepped
+  // with stepMarquee(-n, 0), or bRightToLeft (DMDArabicSource) at the left edge, stepMarquee(n, 0).
+  // stepMarquee returns true when a rewindable source starts over
+  void drawMarquee(DMDTextSource *source, int top, boolean bRightToLeft = false);
 
   // Move the maquee accross by amount
   boolean stepMarquee(int amountX, int amountY);
 
+  // Marquee speed in pixels per second, 16.16 fixed point (DMD_SPEED), for updateMarquee
+  void setMarqueeSpeed(int32_t speedX, int32_t speedY);
+
+  // Move the marquee by the whole pixels due at that speed since the last call, in a single
+  // stepMarquee however late the call is. timeUs is micros(), the first call only starts the clock
+  boolean updateMarquee(uint32_t timeUs);
+
+  // Move everything in DMD RAM by amountX, amountY pixels, the pixels uncovered are cleared
+  void shiftScreen(int amountX, int amountY);
+
+  // Same, for the pixels inside the rectangle x1,y1 - x2,y2 only
+  void shiftRect(int x1, int y1, int x2, int y2, int amountX, int amountY);
+
+  // Write every pixel of the rectangle x1,y1 - x2,y2 inside the clip rectangle as a lit pixel
+  // in bGraphicsMode, a panel word at a time: GRAPHICS_INVERSE clears it, GRAPHICS_NORMAL
+  // lights it at the intensity, GRAPHICS_TOGGLE flips it
+  void fillRect(int x1, int y1, int x2, int y2, byte bGraphicsMode);
+
+  // Render marquees once into an off screen strip, so every stepMarquee copies a window of the
+  // strip into DMD RAM whatever the text length or font. The marquee then owns the full width of
+  // the rows it covers. Takes effect from the next drawMarquee/drawArabicMarquee
+  void enableMarqueeStrip(boolean bEnable);
+
   // Clear the screen in DMD RAM
   void clearScreen(byte bNormal);
 
@@ -174,30 +274,235 @@ public:
   // Insert the calls to this function into the main loop for the highest call rate, or from a timer interrupt
   void scanDisplayBySPI();
 
-  void drawContainer(DMDContainer *container);
+  // Copy a container onto the display at its x0,y0, its lit and unlit pixels drawn with
+  // bGraphicsMode (GRAPHICS_NORMAL overwrites the area, GRAPHICS_OR only lights, GRAPHICS_AND
+  // only clears, GRAPHICS_TOGGLE flips), inside the clip rectangle
+  void drawContainer(DMDContainer *container, byte bGraphicsMode = GRAPHICS_NORMAL);
+
+  // Dirty tracking: every drawing call records the span of each pixel row it touched.
+  // isDirty reports whether anything changed since clearDirty, getDirtyRow the changed span of row bY
+  // and getDirtyRect the bounding box of all changes
+  boolean isDirty();
+  boolean getDirtyRow(int bY, int &x1, int &x2);
+  boolean getDirtyRect(int &x1, int &y1, int &x2, int &y2);
+  void clearDirty();
+
+  // Scan the display from a timer interrupt owned by the DMD, at refreshHz full refreshes per second.
+  // The scan line period is clamped to the time the panels take to clock out at spiClk.
+  // Replaces wiring up scanDisplayBySPI to a timer by hand
+  boolean beginScanning(uint16_t refreshHz);
+  void endScanning();
+
+  // Replace the timer beginScanning uses (default is an ESP32 hardware timer), call before beginScanning
+  void setScanTimer(DMDScanTimer *timer);
+
+  // Scan statistics while scanning: scan line period, last and longest scan duration,
+  // and the number of scans that overran their period or were skipped
+  uint32_t getScanPeriodUs();
+  uint32_t getScanDurationUs();
+  uint32_t getMaxScanDurationUs();
+  uint32_t getMissedDeadlines();
+
+  // Dim the display, 0 (off) to 255 (full, default). Below full the lit rows of every scan line
+  // are gated by an LEDC PWM on nOE, started and stopped with each latch
+  void setBrightness(byte bBrightness);
+  byte getBrightness();
+
+  // Select SCAN_MODE_BURST (default) or SCAN_MODE_BYTEWISE for scanDisplayBySPI
+  void setScanMode(byte bScanMode);
+
+  // Replace the bus the display is scanned out on (default is VSPI), the bus is begun on the DMD pins.
+  // The default bus is deleted, releasing its SPI port; a bus passed in stays the caller's. The scan
+  // timer is stopped while the bus is swapped. NULL is ignored
+  void setSpiBus(DMDSpiBus *bus);
+
+  // Draw into a back buffer from now on, shown by swapBuffers(). With bCopyOnSwap the new back
+  // buffer starts as a copy of the frame just shown, for code that draws incrementally (marquees)
+  void enableDoubleBuffer(boolean bCopyOnSwap);
+
+  // Show the back buffer. With beginScanning the scan picks it up at the start of its next pass
+  // (scan line 0) and this waits for it, up to two passes: false if the scan did not run in that
+  // time (PIN_OTHER_SPI_nCS held), with nothing swapped. Without beginScanning (scanDisplayBySPI
+  // called from the sketch) the buffers are swapped at once
+  boolean swapBuffers();
+
+protected:
+  // For DMDFixed: DMD RAM, the burst staging buffer and the dirty spans (2 per pixel row)
+  // in storage the caller owns, instead of allocated
+  DMD(byte panelsWide, byte panelsHigh,
+      uint8_t nOEPin, uint8_t aPin, uint8_t bPin, uint8_t clkPin, uint8_t latPin, uint8_t rDataPin,
+      byte *screenRAM, byte *scanRAM, int16_t *dirtyRows);
+
+  // Apply a graphics mode to the pixel at lookup in byte offset of every bit plane of DMD RAM,
+  // planes planeBytes apart
+  void writeRamPixel(unsigned int offset, byte lookup, unsigned int planeBytes, byte bGraphicsMode, byte bPixel)
+  {
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+    {
+      byte *p = bDMDScreenRAM + plane * planeBytes + offset;
+      byte mode = bGraphicsMode;
+      byte pixel = bPixel;
+      if (((bIntensity >> plane) & 1) == 0)
+      {
+        // this plane is not part of the intensity, a lit pixel stays off in it
+        if (mode == GRAPHICS_NORMAL || mode == GRAPHICS_INVERSE)
+        {
+          mode = GRAPHICS_NORMAL;
+          pixel = false;
+        }
+        else if (mode != GRAPHICS_NOR && mode != GRAPHICS_AND)
+          continue;
+      }
+
+      switch (mode)
+      {
+      case GRAPHICS_NORMAL:
+        if (pixel == true)
+          *p &= ~lookup; // zero bit is pixel on
+        else
+          *p |= lookup; // one bit is pixel off
+        break;
+      case GRAPHICS_INVERSE:
+        if (pixel == false)
+          *p &= ~lookup; // zero bit is pixel on
+        else
+          *p |= lookup; // one bit is pixel off
+        break;
+      case GRAPHICS_TOGGLE:
+        if (pixel == true)
+          *p ^= lookup;
+        break;
+      case GRAPHICS_OR:
+        // only set pixels on
+        if (pixel == true)
+          *p &= ~lookup; // zero bit is pixel on
+        break;
+      case GRAPHICS_NOR:
+        // only clear on pixels
+        if (pixel == true)
+          *p |= lookup; // one bit is pixel off
+        break;
+      case GRAPHICS_AND:
+        // only keep on pixels under a lit pixel
+        if (pixel == false)
+          *p |= lookup; // one bit is pixel off
+        break;
+      }
+    }
+  }
+
+  // Intensity level of the pixel at lookup in byte offset of DMD RAM, planes planeBytes apart
+  byte readRamLevel(unsigned int offset, byte lookup, unsigned int planeBytes)
+  {
+    byte level = 0;
+    for (byte plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+    {
+      // zero bit is pixel on
+      if ((bDMDScreenRAM[plane * planeBytes + offset] & lookup) == 0)
+        level |= 1 << plane;
+    }
+    return level;
+  }
+
+  // Record that the (already clipped) rectangle x1,y1 - x2,y2 of DMD RAM was written
+  void markDirty(int x1, int y1, int x2, int y2);
 
 private:
   // GPIOs
   uint8_t _nOEPin, _aPin, _bPin, _clkPin, _latPin, _rDataPin;
 
-  void init(byte panelsWide, byte panelsHigh);
+  void init(byte panelsWide, byte panelsHigh, byte *screenRAM, byte *scanRAM, int16_t *dirtyRows);
 
   void drawCircleSub(int cx, int cy, int x, int y, byte bGraphicsMode);
 
+  // Interleave the row3/row2/row1/row0 bytes of a scan line into bDMDScanRAM, in shift out order
+  void stageScanLine(byte bScanLine);
+
+  // Redraw the marquee characters that cross columns x1 to x2
+  void redrawMarqueeColumns(int x1, int x2);
+
+  // Draw the marquee text where it is, from the strip when there is one
+  void drawMarqueeText();
+
+  // Grow marqueeText to hold length characters and the terminator
+  boolean reserveMarquee(unsigned int length);
+
+  // Shape utf8Text into visual order glyphs for the current font, from the shape cache when it
+  // holds them. The glyphs are to be freed when owned is set
+  const char *shapeArabic(const char *utf8Text, unsigned int &length, int &width, boolean &owned);
+
+  // Draw text width pixels wide filling the columns x1 to x2 by widening its spaces, false
+  // (nothing drawn) when it has no spaces or does not fit
+  boolean drawJustified(int x1, int x2, int bY, const char *bChars, unsigned int length, int width, boolean compact, byte bGraphicsMode);
+
+  // stepMarquee of a streamed marquee, and redraw of its recent glyphs crossing columns x1 to x2
+  boolean stepMarqueeSource(int amountX, int amountY);
+  void redrawRecentGlyphs(int x1, int x2);
+
+  // Rasterize the marquee text into marqueeStrip, and copy it to DMD RAM at the marquee
+  // position clearing the rows of a band that started at row oldTop
+  void renderMarqueeStrip();
+  void blitMarqueeStrip(int oldTop);
+
+  // Timer callback of beginScanning, runs one scan and keeps the statistics
+  static void scanTimerCallback(void *arg);
+  void scanTick();
+
+  // Write a glyph (or a solid block when glyph is NULL) into DMD RAM a column at a time
+  void blitColumns(int bX, int bY, const uint8_t *glyph, int width, uint8_t height, int rows, byte bGraphicsMode);
+
   // Mirror of DMD pixels in RAM, ready to be clocked out by the main loop or high speed timer calls
   byte *bDMDScreenRAM;
 
+  // Buffer being scanned out, the same as bDMDScreenRAM unless double buffered,
+  // and the back buffer handed over by swapBuffers until the scan picks it up
+  byte *volatile bDMDFrontRAM;
+  byte *volatile bDMDPendingRAM;
+  boolean bDoubleBuffered;
+  boolean bCopyOnSwap;
+
+  // Dirty span of every pixel row (min > max when clean), and which staged scan lines
+  // need rebuilding before they are sent. Drawing sets bStageDirty, the scan clears it
+  int16_t *dirtyMinX;
+  int16_t *dirtyMaxX;
+  volatile byte bStageDirty[4];
+
   // Marquee values
-  char marqueeText[256];
-  byte marqueeLength;
+  char *marqueeText;
+  unsigned int marqueeLength;
+  unsigned int marqueeCapacity;
   int marqueeWidth;
   int marqueeHeight;
   int marqueeOffsetX;
   int marqueeOffsetY;
   bool marqueeNoSpacing;
 
-  // Pointer to current font
-  const uint8_t *Font;
+  // Time based stepping of updateMarquee
+  DMDScrollClock marqueeClock;
+
+  // Streamed marquee, the end of the text drawn so far and the last glyphs drawn
+  DMDTextSource *marqueeSource;
+  boolean marqueeRightToLeft;
+  int marqueeEdgeX;
+  byte marqueeRecent[DMD_MARQUEE_RECENT];
+  int marqueeRecentX[DMD_MARQUEE_RECENT];
+  byte marqueeRecentCount;
+
+  // Pre-rendered marquee, marqueeStripRows rows of marqueeStripWords 32 bit words (DMD RAM
+  // polarity, most significant bit leftmost). Column 0 is the blank column left of the text
+  boolean bMarqueeStrip;
+  byte *marqueeStrip;
+  int marqueeStripWords;
+  int marqueeStripRows;
+
+  // Rectangle glyphs are clipped to
+  int clipX1, clipY1, clipX2, clipY2;
+
+  // Current font, with its glyph table cached in RAM
+  DMDFont Font;
+
+  // Shaped Arabic text of setShapeCache
+  DMDShapeCache *shapeCache;
 
   // Display information
   byte DisplaysWide;
@@ -208,8 +513,35 @@ private:
   // scanning pointer into bDMDScreenRAM, setup init @ 48 for the first valid scan
   volatile byte bDMDByte;
 
-  // uninitalised pointer to SPI object
-  SPIClass *vspi = NULL;
+  // Bit plane being scanned, and the scan calls left that the latched plane stays lit
+  volatile byte bDMDPlane;
+  volatile byte bPlaneHold;
+
+  // Intensity lit pixels are drawn at
+  byte bIntensity;
+
+  // Brightness, and when bPwmAttached the GPIO matrix signal of the LEDC channel driving nOE
+  // at the brightness duty while rows are lit
+  byte bBrightness;
+  volatile uint32_t oeSignal;
+  volatile boolean bPwmAttached;
+
+  // Staging buffer for SCAN_MODE_BURST, each scan line as the contiguous byte stream sent to the panels
+  byte *bDMDScanRAM;
+  byte bScanMode;
+
+  // Scan timer and statistics of beginScanning
+  DMDScanTimer *scanTimer = NULL;
+  boolean bScanning;
+  uint32_t scanPeriodUs;
+  uint32_t lastScanStartUs;
+  volatile uint32_t scanDurationUs;
+  volatile uint32_t maxScanDurationUs;
+  volatile uint32_t missedDeadlines;
+
+  // uninitalised pointer to the bus the display is scanned out on
+  DMDSpiBus *spiBus = NULL;
+  boolean bOwnsSpiBus; // spiBus is the default bus made by init
   static const int spiClk = 4000000; // 4 MHz SPI clock
 
   void lightRow_01_05_09_13()
@@ -242,14 +574,85 @@ private:
     digitalWrite(_latPin, LOW);
   }
 
+  // With PWM, nOE is switched in the GPIO matrix between the LEDC channel and its GPIO output,
+  // held LOW; ledcWrite takes a driver lock and is not in IRAM, so it is kept out of the scan
   void oeRowsOff()
   {
-    digitalWrite(_nOEPin, LOW);
+    if (bPwmAttached)
+      esp_rom_gpio_connect_out_signal(_nOEPin, SIG_GPIO_OUT_IDX, false, false);
+    else
+      digitalWrite(_nOEPin, LOW);
   }
 
   void oeRowsOn()
   {
-    digitalWrite(_nOEPin, HIGH);
+    if (bPwmAttached)
+      esp_rom_gpio_connect_out_signal(_nOEPin, oeSignal, false, false);
+    else
+      digitalWrite(_nOEPin, HIGH);
+  }
+};
+
+// Storage of a DMDFixed, a base class so it exists before DMD is constructed in it
+template <byte PanelsWide, byte PanelsHigh>
+struct DMDFixedRAM
+{
+  byte screenRAM[PanelsWide * PanelsHigh * DMD_RAM_SIZE_BYTES];
+  byte scanRAM[PanelsWide * PanelsHigh * DMD_RAM_SIZE_BYTES];
+  int16_t dirtyRows[2 * PanelsHigh * DMD_PIXELS_DOWN];
+};
+
+// A DMD with the panel grid fixed at compile time, for layouts that never change. DMD RAM, the
+// scan staging buffer and the dirty spans are part of the object instead of allocated.
+// Constant addressing is limited to two accessors: writePixelFixed/readPixelLevelFixed work out
+// the panel, byte and plane of a pixel with constant divides and offsets. writePixel, drawChar,
+// the blits, shiftRect and the scan row interleave are DMD's code and read the row stride from
+// DisplaysWide/DisplaysTotal at runtime, as for any DMD
+template <byte PanelsWide, byte PanelsHigh>
+class DMDFixed : private DMDFixedRAM<PanelsWide, PanelsHigh>, public DMD
+{
+  static_assert(PanelsWide * PanelsHigh >= 1 && PanelsWide * PanelsHigh <= 255, "1 to 255 panels");
+
+public:
+  static const int Width = DMD_PIXELS_ACROSS * PanelsWide;
+  static const int Height = DMD_PIXELS_DOWN * PanelsHigh;
+
+  DMDFixed()
+      : DMD(PanelsWide, PanelsHigh, PIN_DMD_nOE, PIN_DMD_A, PIN_DMD_B, PIN_DMD_CLK, PIN_DMD_LAT, PIN_DMD_R_DATA,
+            this->screenRAM, this->scanRAM, this->dirtyRows)
+  {
+  }
+
+  DMDFixed(uint8_t nOEPin, uint8_t aPin, uint8_t bPin, uint8_t clkPin, uint8_t latPin, uint8_t rDataPin)
+      : DMD(PanelsWide, PanelsHigh, nOEPin, aPin, bPin, clkPin, latPin, rDataPin,
+            this->screenRAM, this->scanRAM, this->dirtyRows)
+  {
+  }
+
+  // writePixel and readPixelLevel with the grid size folded in
+  void writePixelFixed(unsigned int bX, unsigned int bY, byte bGraphicsMode, byte bPixel)
+  {
+    if (bX >= (unsigned int)Width || bY >= (unsigned int)Height)
+      return;
+    writeRamPixel(ramOffset(bX, bY), bPixelLookupTable[bX & 0x07], planeBytes, bGraphicsMode, bPixel);
+    markDirty(bX, bY, bX, bY);
+  }
+
+  byte readPixelLevelFixed(unsigned int bX, unsigned int bY)
+  {
+    if (bX >= (unsigned int)Width || bY >= (unsigned int)Height)
+      return 0;
+    return readRamLevel(ramOffset(bX, bY), bPixelLookupTable[bX & 0x07], planeBytes);
+  }
+
+private:
+  static const unsigned int planeBytes = DMD_PLANE_SIZE_BYTES * PanelsWide * PanelsHigh;
+
+  // Byte of DMD RAM holding pixel bX,bY, as in DMD::writePixel
+  static unsigned int ramOffset(unsigned int bX, unsigned int bY)
+  {
+    unsigned int panel = (bX / DMD_PIXELS_ACROSS) + (PanelsWide * (bY / DMD_PIXELS_DOWN));
+    return ((bX % DMD_PIXELS_ACROSS) + (panel << 5)) / 8 + (bY % DMD_PIXELS_DOWN) * (PanelsWide * PanelsHigh * 4);
   }
 };
 
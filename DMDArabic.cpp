@@ -0,0 +1,148 @@
+#include "DMDArabic.h"
+#include "Arduino.h"
+
+// Joining bits of a codepoint: it joins the letter before, the letter after, and its glyph
+// is the first of its forms (isolated, final, initial, medial for dual joining letters,
+// isolated, final for right joining ones)
+#define ARABIC_JOINS_PREV 0x01
+#define ARABIC_JOINS_NEXT 0x02
+#define ARABIC_HAS_FORMS 0x04
+
+static const uint8_t ARABIC_GLYPH_TATWEEL = 0xEF;
+static const uint8_t ARABIC_GLYPH_SPACE = 0xF0;
+static const uint8_t ARABIC_GLYPH_DIGIT_0 = 0xF1;
+static const uint8_t ARABIC_GLYPH_COMMA = 0xFB;
+static const uint8_t ARABIC_GLYPH_DOT = 0xFC;
+static const uint8_t ARABIC_GLYPH_QUESTION = 0xFD;
+static const uint8_t ARABIC_GLYPH_LAM_ALEF_ISO = 0xFE;
+static const uint8_t ARABIC_GLYPH_LAM_ALEF_FINAL = 0xFF;
+
+// Glyph of every codepoint of U+0600-U+06FF, its isolated form for letters, 0 for none
+static const uint8_t kArabicGlyphs[256] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFB, 0x00, 0x00, 0x00, // U+0600
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFD, // U+0610
+    0x00, 0x80, 0x81, 0x83, 0x00, 0x85, 0x00, 0x87, 0x89, 0x8D, 0x8F, 0x93, 0x97, 0x9B, 0x9F, 0xA3, // U+0620
+    0xA5, 0xA7, 0xA9, 0xAB, 0xAF, 0xB3, 0xB7, 0xBB, 0xBF, 0xC3, 0xC7, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0630
+    0xEF, 0xCB, 0xCF, 0xD3, 0xD7, 0xDB, 0xDF, 0xE3, 0xE7, 0xE9, 0xEB, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0640
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0650
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0660
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0670
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0680
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0690
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06A0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06B0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06C0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06D0
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06E0
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+06F0
+};
+
+// Joining type of the same codepoints as in Unicode ArabicShaping.txt: U non joining,
+// R right joining, D dual joining, C join causing (tatweel)
+static const char kArabicJoining[256 + 1] PROGMEM =
+    "UUUUUUUUUUUUUUUU" // U+0600
+    "UUUUUUUUUUUUUUUU" // U+0610
+    "UURRURURDRDDDDDR" // U+0620
+    "RRRDDDDDDDDUUUUU" // U+0630
+    "CDDDDDDDRRDUUUUU" // U+0640
+    "UUUUUUUUUUUUUUUU" // U+0650
+    "UUUUUUUUUUUUUUUU" // U+0660
+    "UUUUUUUUUUUUUUUU" // U+0670
+    "UUUUUUUUUUUUUUUU" // U+0680
+    "UUUUUUUUUUUUUUUU" // U+0690
+    "UUUUUUUUUUUUUUUU" // U+06A0
+    "UUUUUUUUUUUUUUUU" // U+06B0
+    "UUUUUUUUUUUUUUUU" // U+06C0
+    "UUUUUUUUUUUUUUUU" // U+06D0
+    "UUUUUUUUUUUUUUUU" // U+06E0
+    "UUUUUUUUUUUUUUUU"; // U+06F0
+
+// Glyph and joining bits of any codepoint, each looked up once as it is pushed
+static void lookupArabicForm(uint32_t codepoint, uint8_t &glyph, uint8_t &joining)
+{
+    joining = 0;
+    // Latin ASCII characters (font now includes 0x20-0x7F range)
+    if (codepoint >= 0x0020 && codepoint <= 0x007E)
+    {
+        glyph = (uint8_t)codepoint; // Direct mapping
+        return;
+    }
+    if (codepoint < 0x0600 || codepoint > 0x06FF)
+    {
+        glyph = 0;
+        return;
+    }
+    glyph = pgm_read_byte(kArabicGlyphs + (codepoint - 0x0600));
+    switch (pgm_read_byte(kArabicJoining + (codepoint - 0x0600)))
+    {
+    case 'R':
+        joining = ARABIC_JOINS_PREV | ARABIC_HAS_FORMS;
+        break;
+    case 'D':
+        joining = ARABIC_JOINS_PREV | ARABIC_JOINS_NEXT | ARABIC_HAS_FORMS;
+        break;
+    case 'C':
+        joining = ARABIC_JOINS_PREV | ARABIC_JOINS_NEXT;
+        break;
+    }
+}
+
+static bool isLamAlefPair(uint32_t curr, uint32_t next)
+{
+    return curr == 0x0644 && (next == 0x0627 || next == 0x0622 || next == 0x0623 || next == 0x0625);
+}
+
+DMDArabicShaper::DMDArabicShaper()
+{
+    reset();
+}
+
+void DMDArabicShaper::reset()
+{
+    _curr = 0;
+    _currGlyph = 0;
+    _currJoining = 0;
+    _prevJoinsNext = false;
+}
+
+uint8_t DMDArabicShaper::push(uint32_t codepoint)
+{
+    uint32_t cp = _curr;
+    uint8_t glyph = _currGlyph;
+    uint8_t joining = _currJoining;
+    // the codepoint is looked up once here, and carried as the current one to the next push
+    lookupArabicForm(codepoint, _currGlyph, _currJoining);
+    _curr = codepoint;
+    if (cp == 0)
+    {
+        // nothing waiting, the first codepoint of the text or the one after a ligature
+        if (codepoint == 0)
+            _prevJoinsNext = false;
+        return 0;
+    }
+
+    uint8_t mapped;
+    if (isLamAlefPair(cp, codepoint))
+    {
+        mapped = _prevJoinsNext ? ARABIC_GLYPH_LAM_ALEF_FINAL : ARABIC_GLYPH_LAM_ALEF_ISO;
+        // the alef is drawn by the ligature, it is only the letter before the next one
+        _prevJoinsNext = (_currJoining & ARABIC_JOINS_NEXT) != 0;
+        _curr = 0;
+        return mapped;
+    }
+
+    mapped = glyph;
+    if (joining & ARABIC_HAS_FORMS)
+    {
+        // isolated, final, initial and medial forms follow each other
+        if (_prevJoinsNext)
+            mapped += 1;
+        if ((joining & ARABIC_JOINS_NEXT) && (_currJoining & ARABIC_JOINS_PREV))
+            mapped += 2;
+    }
+
+    _prevJoinsNext = (joining & ARABIC_JOINS_NEXT) != 0;
+    if (codepoint == 0)
+        _prevJoinsNext = false;
+    return mapped;
+}
@@ -0,0 +1,30 @@
+#ifndef DMD_ARABIC_H
+#define DMD_ARABIC_H
+
+#include "stdint.h"
+
+// Contextual shaping of Arabic codepoints into fonts/ArabicFont.h glyph codes
+// (isolated/initial/medial/final forms and the lam-alef ligatures). The shaper
+// only looks one codepoint back and one ahead, so text of any length can be
+// shaped as it is decoded, without holding it all in RAM
+class DMDArabicShaper
+{
+public:
+    DMDArabicShaper();
+    void reset();
+
+    // Feed the next codepoint of the text, 0 once the text is over. The form of a letter
+    // depends on the letter after it, so this returns the glyph code of the codepoint fed
+    // before (or 0 if that one has no glyph, or is still waiting for its next codepoint)
+    uint8_t push(uint32_t codepoint);
+
+private:
+    // The codepoint waiting for the one after it, with its glyph and joining bits, and
+    // whether the letter before it joins forward
+    uint32_t _curr;
+    uint8_t _currGlyph;
+    uint8_t _currJoining;
+    bool _prevJoinsNext;
+};
+
+#endif
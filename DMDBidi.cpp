@@ -0,0 +1,239 @@
+#include "DMDBidi.h"
+
+uint8_t DMDBidi::glyphClass(uint8_t glyph)
+{
+    if ((glyph >= 'A' && glyph <= 'Z') || (glyph >= 'a' && glyph <= 'z'))
+        return DMD_BIDI_L;
+    if (glyph >= '0' && glyph <= '9')
+        return DMD_BIDI_EN; // Arabic-Indic digits are mapped to these too
+    switch (glyph)
+    {
+    case ' ':
+    case 0xF0: // Arabic space
+        return DMD_BIDI_WS;
+    case '+':
+    case '-':
+        return DMD_BIDI_ES;
+    case '#':
+    case '$':
+    case '%':
+        return DMD_BIDI_ET;
+    case ',':
+    case '.':
+    case '/':
+    case ':':
+    case 0xFB: // Arabic comma
+    case 0xFC: // Arabic dot
+        return DMD_BIDI_CS;
+    }
+    if (glyph >= 0xF1 && glyph <= 0xFA)
+        return DMD_BIDI_AN; // Arabic digits
+    // letter forms, tatweel, the Arabic question mark and the lam-alef ligatures
+    if (glyph >= 0x80)
+        return DMD_BIDI_AL;
+    return DMD_BIDI_ON;
+}
+
+static inline bool isNeutral(uint8_t type)
+{
+    return type == DMD_BIDI_B || type == DMD_BIDI_S || type == DMD_BIDI_WS || type == DMD_BIDI_ON;
+}
+
+// Direction a resolved type gives neighbouring neutrals, numbers count as right to left (N1)
+static inline uint8_t neutralContext(uint8_t type)
+{
+    return (type == DMD_BIDI_L) ? DMD_BIDI_L : DMD_BIDI_R;
+}
+
+uint8_t DMDBidi::resolve(const uint8_t *classes, unsigned int length, int8_t paragraphLevel, uint8_t *levels)
+{
+    unsigned int i, j;
+    // P2, P3: the first strong letter sets the paragraph level
+    if (paragraphLevel < 0)
+    {
+        paragraphLevel = 0;
+        for (i = 0; i < length; i++)
+        {
+            if (classes[i] == DMD_BIDI_L)
+                break;
+            if (classes[i] == DMD_BIDI_R || classes[i] == DMD_BIDI_AL)
+            {
+                paragraphLevel = 1;
+                break;
+            }
+        }
+    }
+    uint8_t level = paragraphLevel & 1;
+    // the whole line is one level run, starting and ending in the paragraph direction
+    uint8_t sos = level ? DMD_BIDI_R : DMD_BIDI_L;
+
+    // levels holds the types being resolved until I1/I2 turn them into levels
+
+    // W1 marks take the type before them, W2 European numbers after an Arabic letter are
+    // Arabic numbers, W3 Arabic letters are right to left
+    uint8_t prev = sos, strong = sos;
+    for (i = 0; i < length; i++)
+    {
+        uint8_t t = classes[i];
+        if (t == DMD_BIDI_NSM)
+            t = prev;
+        prev = t;
+        if (t == DMD_BIDI_L || t == DMD_BIDI_R || t == DMD_BIDI_AL)
+            strong = t;
+        else if (t == DMD_BIDI_EN && strong == DMD_BIDI_AL)
+            t = DMD_BIDI_AN;
+        levels[i] = (t == DMD_BIDI_AL) ? DMD_BIDI_R : t;
+    }
+
+    // W4 a single separator between two numbers of the same kind joins them
+    for (i = 1; i + 1 < length; i++)
+    {
+        uint8_t t = levels[i], before = levels[i - 1];
+        if (levels[i + 1] != before)
+            continue;
+        if ((t == DMD_BIDI_ES && before == DMD_BIDI_EN) ||
+            (t == DMD_BIDI_CS && (before == DMD_BIDI_EN || before == DMD_BIDI_AN)))
+            levels[i] = before;
+    }
+
+    // W5 terminators next to a European number are part of it, W6 other separators and
+    // terminators are neutral
+    for (i = 0; i < length; i = j)
+    {
+        j = i + 1;
+        uint8_t t = levels[i];
+        if (t == DMD_BIDI_ET)
+        {
+            while (j < length && levels[j] == DMD_BIDI_ET)
+                j++;
+            if ((i > 0 && levels[i - 1] == DMD_BIDI_EN) || (j < length && levels[j] == DMD_BIDI_EN))
+                t = DMD_BIDI_EN;
+            else
+                t = DMD_BIDI_ON;
+        }
+        else if (t == DMD_BIDI_ES || t == DMD_BIDI_CS)
+            t = DMD_BIDI_ON;
+        for (unsigned int k = i; k < j; k++)
+            levels[k] = t;
+    }
+
+    // W7 European numbers in left to right text are left to right
+    strong = sos;
+    for (i = 0; i < length; i++)
+    {
+        if (levels[i] == DMD_BIDI_L || levels[i] == DMD_BIDI_R)
+            strong = levels[i];
+        else if (levels[i] == DMD_BIDI_EN && strong == DMD_BIDI_L)
+            levels[i] = DMD_BIDI_L;
+    }
+
+    // N1 neutrals between two of the same direction take it, N2 the rest take the paragraph's
+    for (i = 0; i < length; i = j)
+    {
+        j = i + 1;
+        if (!isNeutral(levels[i]))
+            continue;
+        while (j < length && isNeutral(levels[j]))
+            j++;
+        uint8_t before = (i > 0) ? neutralContext(levels[i - 1]) : sos;
+        uint8_t after = (j < length) ? neutralContext(levels[j]) : sos;
+        uint8_t t = (before == after) ? before : sos;
+        for (unsigned int k = i; k < j; k++)
+            levels[k] = t;
+    }
+
+    // I1, I2 implicit levels
+    for (i = 0; i < length; i++)
+    {
+        uint8_t t = levels[i];
+        if (level == 0)
+            levels[i] = (t == DMD_BIDI_R) ? 1 : (t == DMD_BIDI_L) ? 0 : 2;
+        else
+            levels[i] = (t == DMD_BIDI_R) ? 1 : 2;
+    }
+
+    // L1 separators, and whitespace before them or at the end of the line, are at the
+    // paragraph level
+    bool trailing = true;
+    for (i = length; i-- > 0;)
+    {
+        uint8_t c = classes[i];
+        if (c == DMD_BIDI_S || c == DMD_BIDI_B)
+        {
+            levels[i] = level;
+            trailing = true;
+        }
+        else if (c == DMD_BIDI_WS && trailing)
+            levels[i] = level;
+        else
+            trailing = false;
+    }
+    return level;
+}
+
+static char mirrorGlyph(char c)
+{
+    switch (c)
+    {
+    case '(':
+        return ')';
+    case ')':
+        return '(';
+    case '[':
+        return ']';
+    case ']':
+        return '[';
+    case '{':
+        return '}';
+    case '}':
+        return '{';
+    case '<':
+        return '>';
+    case '>':
+        return '<';
+    }
+    return c;
+}
+
+void DMDBidi::reorder(char *text, uint8_t *levels, unsigned int length)
+{
+    uint8_t highest = 0, lowestOdd = 0xFF;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        if (levels[i] & 1)
+        {
+            text[i] = mirrorGlyph(text[i]);
+            if (levels[i] < lowestOdd)
+                lowestOdd = levels[i];
+        }
+        if (levels[i] > highest)
+            highest = levels[i];
+    }
+
+    // L2 from the highest level down to the lowest odd one, reverse every run at that level or above
+    for (uint8_t level = highest; level >= lowestOdd && level > 0; level--)
+    {
+        unsigned int i = 0;
+        while (i < length)
+        {
+            if (levels[i] < level)
+            {
+                i++;
+                continue;
+            }
+            unsigned int j = i;
+            while (j < length && levels[j] >= level)
+                j++;
+            for (unsigned int a = i, b = j - 1; a < b; a++, b--)
+            {
+                char t = text[a];
+                text[a] = text[b];
+                text[b] = t;
+                uint8_t l = levels[a];
+                levels[a] = levels[b];
+                levels[b] = l;
+            }
+            i = j;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DMD_BIDI_H
+#define DMD_BIDI_H
+
+#include "stdint.h"
+
+// Bidirectional classes of Unicode UAX #9 the resolver knows
+#define DMD_BIDI_L 0   // left to right letter
+#define DMD_BIDI_R 1   // right to left letter
+#define DMD_BIDI_AL 2  // Arabic letter
+#define DMD_BIDI_EN 3  // European number
+#define DMD_BIDI_ES 4  // European separator (+ -)
+#define DMD_BIDI_ET 5  // European terminator (# $ %)
+#define DMD_BIDI_AN 6  // Arabic number
+#define DMD_BIDI_CS 7  // common separator (, . / :)
+#define DMD_BIDI_NSM 8 // non spacing mark
+#define DMD_BIDI_B 9   // paragraph separator
+#define DMD_BIDI_S 10  // segment separator (tab)
+#define DMD_BIDI_WS 11 // whitespace
+#define DMD_BIDI_ON 12 // other neutral
+
+// Paragraph level taken from the first strong letter (rules P2 and P3)
+#define DMD_BIDI_AUTO -1
+
+// Resolver of the implicit part of the Unicode bidirectional algorithm for one line of one
+// paragraph: weak types (W1-W7), neutrals (N1, N2), implicit levels (I1, I2), trailing
+// whitespace (L1), reordering (L2) and bracket mirroring (L4). Explicit embeddings, isolates
+// and bracket pairs (N0) are not handled, their characters are other neutrals. Every rule
+// is a pass or two over the line, with no memory beyond the buffers passed in
+class DMDBidi
+{
+public:
+    // Bidi class of a glyph code of fonts/ArabicFont.h as made by DMD::utf8ToArabic
+    static uint8_t glyphClass(uint8_t glyph);
+
+    // Embedding level of each of the length characters of classes into levels, in a paragraph
+    // of level 0 (left to right), 1 (right to left) or DMD_BIDI_AUTO. Returns the paragraph level
+    static uint8_t resolve(const uint8_t *classes, unsigned int length, int8_t paragraphLevel, uint8_t *levels);
+
+    // Put text in visual order by its levels, reversing levels along with it, and swap the
+    // brackets ( ) [ ] { } < > at odd levels for their mirror images
+    static void reorder(char *text, uint8_t *levels, unsigned int length);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef DMD_BRIGHTNESS_H
+#define DMD_BRIGHTNESS_H
+
+#include "stdint.h"
+
+// LEDC PWM gating nOE for DMD::setBrightness. The PWM runs many periods per scan line
+// so the dimmed on-time of every line is the same and does not beat with the scan
+#define DMD_PWM_FREQUENCY 100000 // Hz
+#define DMD_PWM_RESOLUTION 8     // bits
+
+// nOE duty for a brightness of 0-255 at resolutionBits of PWM resolution. The curve is
+// quadratic so steps look even to the eye, any brightness above 0 stays visible,
+// and 255 is the full duty (no PWM needed)
+inline uint32_t dmdBrightnessDuty(uint8_t brightness, uint8_t resolutionBits)
+{
+    uint32_t full = ((uint32_t)1 << resolutionBits) - 1;
+    if (brightness == 0)
+        return 0;
+    uint32_t duty = ((uint32_t)brightness * brightness * full + (255UL * 255UL) / 2) / (255UL * 255UL);
+    return (duty == 0) ? 1 : duty;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "DMDCompositor.h"
+
+DMDCompositor::DMDCompositor(DMD *dmd)
+{
+    _dmd = dmd;
+    _layers = NULL;
+    _count = 0;
+    _capacity = 0;
+}
+
+DMDCompositor::~DMDCompositor()
+{
+    free(_layers);
+}
+
+DMDCompositor::Layer *DMDCompositor::find(DMDContainer *container)
+{
+    for (byte i = 0; i < _count; i++)
+    {
+        if (_layers[i].container == container)
+            return &_layers[i];
+    }
+    return NULL;
+}
+
+boolean DMDCompositor::add(DMDContainer *container, int z, byte bGraphicsMode)
+{
+    Layer layer;
+    Layer *old = find(container);
+    if (old != NULL)
+    {
+        // taken out to go back in at its new z, its old area is redrawn by the next compose
+        layer = *old;
+        _count--;
+        for (byte i = old - _layers; i < _count; i++)
+            _layers[i] = _layers[i + 1];
+    }
+    else
+    {
+        if (_count == _capacity)
+        {
+            if (_capacity == 255)
+                return false;
+            byte capacity = (_capacity < 128) ? _capacity * 2 + 4 : 255;
+            Layer *layers = (Layer *)realloc(_layers, capacity * sizeof(Layer));
+            if (layers == NULL)
+                return false;
+            _layers = layers;
+            _capacity = capacity;
+        }
+        layer.container = container;
+        layer.clipX1 = -32768;
+        layer.clipY1 = -32768;
+        layer.clipX2 = 32767;
+        layer.clipY2 = 32767;
+        layer.drawnX1 = 0;
+        layer.drawnX2 = -1;
+    }
+    layer.z = z;
+    layer.mode = bGraphicsMode;
+    layer.dirty = true;
+
+    // kept sorted by z, the latest added on top of its equals
+    byte i = _count;
+    while (i > 0 && _layers[i - 1].z > z)
+    {
+        _layers[i] = _layers[i - 1];
+        i--;
+    }
+    _layers[i] = layer;
+    _count++;
+    return true;
+}
+
+void DMDCompositor::remove(DMDContainer *container)
+{
+    Layer *layer = find(container);
+    if (layer == NULL)
+        return;
+    Layer gone = *layer;
+    _count--;
+    for (byte i = layer - _layers; i < _count; i++)
+        _layers[i] = _layers[i + 1];
+    if (gone.drawnX1 <= gone.drawnX2)
+        recompose(gone.drawnX1, gone.drawnY1, gone.drawnX2, gone.drawnY2);
+}
+
+void DMDCompositor::setClip(DMDContainer *container, int x1, int y1, int x2, int y2)
+{
+    Layer *layer = find(container);
+    if (layer == NULL)
+        return;
+    layer->clipX1 = x1;
+    layer->clipY1 = y1;
+    layer->clipX2 = x2;
+    layer->clipY2 = y2;
+    layer->dirty = true;
+}
+
+void DMDCompositor::clearClip(DMDContainer *container)
+{
+    setClip(container, -32768, -32768, 32767, 32767);
+}
+
+void DMDCompositor::invalidate()
+{
+    for (byte i = 0; i < _count; i++)
+        _layers[i].dirty = true;
+}
+
+boolean DMDCompositor::layerRect(Layer *layer, int &x1, int &y1, int &x2, int &y2)
+{
+    DMDContainer *c = layer->container;
+    x1 = (c->getX0() > layer->clipX1) ? c->getX0() : layer->clipX1;
+    y1 = (c->getY0() > layer->clipY1) ? c->getY0() : layer->clipY1;
+    x2 = (c->getX0() + c->getW() - 1 < layer->clipX2) ? c->getX0() + c->getW() - 1 : layer->clipX2;
+    y2 = (c->getY0() + c->getH() - 1 < layer->clipY2) ? c->getY0() + c->getH() - 1 : layer->clipY2;
+    if (x1 < 0)
+        x1 = 0;
+    if (y1 < 0)
+        y1 = 0;
+    if (x2 >= _dmd->getWidth())
+        x2 = _dmd->getWidth() - 1;
+    if (y2 >= _dmd->getHeight())
+        y2 = _dmd->getHeight() - 1;
+    return x1 <= x2 && y1 <= y2;
+}
+
+boolean DMDCompositor::compose()
+{
+    boolean ret = false;
+    for (byte i = 0; i < _count; i++)
+    {
+        Layer *layer = &_layers[i];
+        if (!layer->dirty && !layer->container->isDirty())
+            continue;
+
+        // the area it covered and the area it covers now, once when they overlap
+        int x1, y1, x2, y2;
+        boolean now = layerRect(layer, x1, y1, x2, y2);
+        boolean before = layer->drawnX1 <= layer->drawnX2;
+        if (now && before && x1 <= layer->drawnX2 && layer->drawnX1 <= x2 &&
+            y1 <= layer->drawnY2 && layer->drawnY1 <= y2)
+        {
+            recompose((x1 < layer->drawnX1) ? x1 : layer->drawnX1, (y1 < layer->drawnY1) ? y1 : layer->drawnY1,
+                      (x2 > layer->drawnX2) ? x2 : layer->drawnX2, (y2 > layer->drawnY2) ? y2 : layer->drawnY2);
+        }
+        else
+        {
+            if (before)
+                recompose(layer->drawnX1, layer->drawnY1, layer->drawnX2, layer->drawnY2);
+            if (now)
+                recompose(x1, y1, x2, y2);
+        }
+        ret = true;
+    }
+    if (!ret)
+        return false;
+
+    for (byte i = 0; i < _count; i++)
+    {
+        Layer *layer = &_layers[i];
+        if (!layer->dirty && !layer->container->isDirty())
+            continue;
+        int x1, y1, x2, y2;
+        if (layerRect(layer, x1, y1, x2, y2))
+        {
+            layer->drawnX1 = x1;
+            layer->drawnY1 = y1;
+            layer->drawnX2 = x2;
+            layer->drawnY2 = y2;
+        }
+        else
+        {
+            layer->drawnX1 = 0;
+            layer->drawnX2 = -1;
+        }
+        layer->dirty = false;
+        layer->container->setDirty(false);
+    }
+    return true;
+}
+
+void DMDCompositor::recompose(int x1, int y1, int x2, int y2)
+{
+    // the area is cleared under its own clip, the layers under theirs
+    int clipX1, clipY1, clipX2, clipY2;
+    _dmd->getClip(clipX1, clipY1, clipX2, clipY2);
+    _dmd->setClip(x1, y1, x2, y2);
+    _dmd->fillRect(x1, y1, x2, y2, GRAPHICS_INVERSE);
+    for (byte i = 0; i < _count; i++)
+    {
+        int lx1, ly1, lx2, ly2;
+        if (!layerRect(&_layers[i], lx1, ly1, lx2, ly2))
+            continue;
+        if (lx1 < x1)
+            lx1 = x1;
+        if (ly1 < y1)
+            ly1 = y1;
+        if (lx2 > x2)
+            lx2 = x2;
+        if (ly2 > y2)
+            ly2 = y2;
+        if (lx1 > lx2 || ly1 > ly2)
+            continue;
+        _dmd->setClip(lx1, ly1, lx2, ly2);
+        _dmd->drawContainer(_layers[i].container, _layers[i].mode);
+    }
+    _dmd->setClip(clipX1, clipY1, clipX2, clipY2);
+}
@@ -0,0 +1,60 @@
+#ifndef DMD_COMPOSITOR_H
+#define DMD_COMPOSITOR_H
+
+#include "DMD32Plus.h"
+
+// Composes a layout of containers (a clock, a ticker, a logo...) onto the display. Containers
+// are drawn from the lowest z up, each with its own graphics mode and clip rectangle, and
+// compose only redraws the areas of the containers that changed, moved, or were added or
+// removed since the last frame, so the cost follows what changed and not the container count
+class DMDCompositor
+{
+public:
+    DMDCompositor(DMD *dmd);
+    ~DMDCompositor();
+    // the layer table is owned, a copy would free it twice
+    DMDCompositor(const DMDCompositor &) = delete;
+    DMDCompositor &operator=(const DMDCompositor &) = delete;
+
+    // Add a container at depth z, drawn over the lower ones with bGraphicsMode: GRAPHICS_NORMAL
+    // is opaque, GRAPHICS_OR, GRAPHICS_AND and GRAPHICS_TOGGLE (xor) are transparent where the
+    // container is unlit, lit, unlit. Adding it again moves it to the new z and mode
+    boolean add(DMDContainer *container, int z, byte bGraphicsMode = GRAPHICS_NORMAL);
+    // Take a container out, redrawing the area it covered straight away
+    void remove(DMDContainer *container);
+
+    // Only show the part of the container inside the display rectangle x1,y1 - x2,y2
+    void setClip(DMDContainer *container, int x1, int y1, int x2, int y2);
+    void clearClip(DMDContainer *container);
+
+    // Redraw the areas that changed, false when there was nothing to do
+    boolean compose();
+
+    // Redraw every container on the next compose
+    void invalidate();
+
+private:
+    struct Layer
+    {
+        DMDContainer *container;
+        int z;
+        byte mode;
+        boolean dirty;
+        int16_t clipX1, clipY1, clipX2, clipY2;
+        // where it was last drawn, x1 > x2 when nowhere
+        int16_t drawnX1, drawnY1, drawnX2, drawnY2;
+    };
+
+    Layer *find(DMDContainer *container);
+    // Rectangle the layer covers now, false when it is empty
+    boolean layerRect(Layer *layer, int &x1, int &y1, int &x2, int &y2);
+    // Clear the rectangle and draw every layer crossing it
+    void recompose(int x1, int y1, int x2, int y2);
+
+    DMD *_dmd;
+    Layer *_layers;
+    byte _count;
+    byte _capacity;
+};
+
+#endif
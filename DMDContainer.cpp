@@ -6,14 +6,36 @@
 #include "constants.h"
 
 DMDContainer::DMDContainer(int16_t x0, int16_t y0, int16_t w, int16_t h)
+{
+    init(x0, y0, w, h, w, h);
+}
+
+DMDContainer::DMDContainer(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t canvasW, int16_t canvasH)
+{
+    init(x0, y0, w, h, canvasW, canvasH);
+}
+
+void DMDContainer::init(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t canvasW, int16_t canvasH)
 {
     _x0 = x0;
     _y0 = y0;
     _w = w;
     _h = h;
+    _canvasW = canvasW;
+    _canvasH = canvasH;
+    _scrollX = 0;
+    _scrollY = 0;
+    _wrap = false;
+
+    _dirty = true;
+    _stride = ((canvasW + 31) / 32) * 4;
+    _buf = (uint8_t *)malloc(_stride * canvasH);
+    clear();
+}
 
-    _buf = (uint8_t *)malloc(w * h);
-    memset(_buf, 0, w * h);
+DMDContainer::~DMDContainer()
+{
+    free(_buf);
 }
 
 uint8_t *DMDContainer::getBufferData()
@@ -21,78 +43,105 @@ uint8_t *DMDContainer::getBufferData()
     return _buf;
 }
 
-uint8_t DMDContainer::appendChar(int16_t x, int16_t y, uint8_t letter)
+uint16_t DMDContainer::getStride()
+{
+    return _stride;
+}
+
+int16_t DMDContainer::getCanvasW()
+{
+    return _canvasW;
+}
+
+int16_t DMDContainer::getCanvasH()
+{
+    return _canvasH;
+}
+
+uint8_t DMDContainer::getPixel(int16_t x, int16_t y)
 {
-    if (x > _w || y > _h)
+    if (x < 0 || y < 0 || x >= _canvasW || y >= _canvasH || _buf == NULL)
         return 0;
-    if (_font == NULL)
+    return (_buf[y * _stride + (x >> 3)] & (0x80 >> (x & 7))) == 0;
+}
+
+// Transpose 8x8 bits: byte 7 - c of m holds column c of the block with row r in bit r,
+// byte r of the result holds row r with column c in bit 7 - c
+static inline uint64_t transpose8x8(uint64_t m)
+{
+    m = (m & 0xAA55AA55AA55AA55ULL) | ((m & 0x00AA00AA00AA00AAULL) << 7) | ((m >> 7) & 0x00AA00AA00AA00AAULL);
+    m = (m & 0xCCCC3333CCCC3333ULL) | ((m & 0x0000CCCC0000CCCCULL) << 14) | ((m >> 14) & 0x0000CCCC0000CCCCULL);
+    m = (m & 0xF0F0F0F00F0F0F0FULL) | ((m & 0x00000000F0F0F0F0ULL) << 28) | ((m >> 28) & 0x00000000F0F0F0F0ULL);
+    return m;
+}
+
+// Write the mask bits of a row byte (column 0 in bit 7, 1 for lit) at any bit of a packed row
+static inline void putRowBits(uint8_t *row, int bit, uint8_t bits, uint8_t mask)
+{
+    uint8_t *p = row + (bit >> 3);
+    int shift = bit & 7;
+    uint8_t m = mask >> shift;
+    // zero bit is pixel on
+    p[0] = (p[0] & ~m) | (~(bits >> shift) & m);
+    m = (uint8_t)(mask << (8 - shift));
+    if (m != 0)
+        p[1] = (p[1] & ~m) | (~(bits << (8 - shift)) & m);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw a glyph into the canvas with its top left at x,y, lit and unlit pixels both. The glyph
+ rectangle is clipped against the canvas once, then each font byte of 8 columns is turned
+ into 8 row bytes by one transpose and written a byte at a time.
+--------------------------------------------------------------------------------------*/
+uint8_t DMDContainer::appendChar(int16_t x, int16_t y, uint8_t letter)
+{
+    if (_font.getFont() == NULL || _buf == NULL)
         return 0;
 
     unsigned char c = letter;
-    uint8_t height = pgm_read_byte(_font + FONT_HEIGHT);
+    uint8_t height = _font.getHeight();
     if (c == ' ')
     {
         int charWide = charWidthOfFont(' ', _font);
         return charWide;
     }
-    uint8_t width = 0;
-    uint8_t bytes = (height + 7) / 8;
-
-    uint8_t firstChar = pgm_read_byte(_font + FONT_FIRST_CHAR);
-    uint8_t charCount = pgm_read_byte(_font + FONT_CHAR_COUNT);
-
-    uint16_t index = 0;
-
-    if (c < firstChar || c >= (firstChar + charCount))
+    uint8_t bytes = _font.getBytesPerColumn();
+    const uint8_t *glyph = _font.getGlyph(c);
+    if (glyph == NULL)
         return 0;
-    c -= firstChar;
+    uint8_t width = _font.getWidth(c);
 
-    if (pgm_read_byte(_font + FONT_LENGTH) == 0 && pgm_read_byte(_font + FONT_LENGTH + 1) == 0)
-    {
-        // zero length is flag indicating fixed width font (array does not contain width data entries)
-        width = pgm_read_byte(_font + FONT_FIXED_WIDTH);
-        index = c * bytes * width + FONT_WIDTH_TABLE;
-    }
-    else
-    {
-        // variable width font, read width data, to get the index
-        for (uint8_t i = 0; i < c; i++)
-        {
-            index += pgm_read_byte(_font + FONT_WIDTH_TABLE + i);
-        }
-        index = index * bytes + charCount + FONT_WIDTH_TABLE;
-        width = pgm_read_byte(_font + FONT_WIDTH_TABLE + c);
-    }
-    if (x < -width || y < -height)
+    // single byte fonts also cover the row just below the glyph, as DMD::drawChar does
+    int rows = (bytes == 1) ? ((height < 8) ? height + 1 : 8) : height;
+    int j1 = (x < 0) ? -x : 0;
+    int j2 = (x + width > _canvasW) ? _canvasW - x : width;
+    int r1 = (y < 0) ? -y : 0;
+    int r2 = (y + rows > _canvasH) ? _canvasH - y : rows;
+    if (j1 >= j2 || r1 >= r2)
         return width;
+    _dirty = true;
 
-    for (uint8_t j = 0; j < width; j++)
-    { // Width
-        for (uint8_t i = bytes - 1; i < 254; i--)
-        { // Vertical Bytes
-            uint8_t data = pgm_read_byte(_font + index + j + (i * width));
-
-            int offset = (i * 8);
-            if ((i == bytes - 1) && bytes > 1)
-            {
-                offset = height - 8;
-            }
-
-            for (uint8_t k = 0; k < 8; k++)
-            {
-                if ((offset + k >= i * 8) && (offset + k <= height))
-                {
-                    int16_t posX = j + x + _x0;
-                    int16_t posY = k + y + _y0 + offset;
-
-                    if (posX < 0)
-                        continue;
-                    if (posX > (_x0 + _w))
-                        continue;
-
-                    _buf[posY * _w + posX] = (data & (1 << k)) >> k;
-                }
-            }
+    for (uint8_t i = 0; i < bytes; i++)
+    {
+        // the last byte of a multi byte column is bottom aligned onto the glyph height,
+        // its rows already covered by the byte above are skipped
+        int top = ((i == bytes - 1) && bytes > 1) ? height - 8 : i * 8;
+        int from = (i * 8 > r1) ? i * 8 : r1;
+        int to = (top + 8 < r2) ? top + 8 : r2;
+        if (from >= to)
+            continue;
+        const uint8_t *column = glyph + i * width;
+        for (int j = j1; j < j2; j += 8)
+        {
+            int count = (j2 - j < 8) ? j2 - j : 8;
+            uint64_t block = 0;
+            for (int k = 0; k < count; k++)
+                block |= (uint64_t)pgm_read_byte(column + j + k) << (8 * (7 - k));
+            block = transpose8x8(block);
+            uint8_t mask = 0xFF << (8 - count);
+            uint8_t *row = _buf + (y + from) * _stride;
+            for (int r = from; r < to; r++, row += _stride)
+                putRowBits(row, x + j, (uint8_t)(block >> (8 * (r - top))), mask);
         }
     }
 
@@ -143,10 +192,76 @@ int16_t DMDContainer::getY1()
 
 void DMDContainer::setFont(const uint8_t *font)
 {
-    _font = font;
+    _font.attach(font);
 }
 
 void DMDContainer::clear()
 {
-    memset(_buf, 0, _w * _h);
+    if (_buf != NULL)
+        memset(_buf, 0xFF, _stride * _canvasH);
+    _dirty = true;
+}
+
+void DMDContainer::setPosition(int16_t x0, int16_t y0)
+{
+    _x0 = x0;
+    _y0 = y0;
+    _dirty = true;
+}
+
+void DMDContainer::setScroll(int16_t x, int16_t y)
+{
+    if (x == _scrollX && y == _scrollY)
+        return;
+    _scrollX = x;
+    _scrollY = y;
+    _dirty = true;
+}
+
+void DMDContainer::scrollBy(int16_t dx, int16_t dy)
+{
+    int16_t x = _scrollX + dx;
+    int16_t y = _scrollY + dy;
+    if (_wrap)
+    {
+        // keep the offset inside the canvas, it repeats anyway
+        x %= _canvasW;
+        if (x < 0)
+            x += _canvasW;
+        y %= _canvasH;
+        if (y < 0)
+            y += _canvasH;
+    }
+    setScroll(x, y);
+}
+
+int16_t DMDContainer::getScrollX()
+{
+    return _scrollX;
+}
+
+int16_t DMDContainer::getScrollY()
+{
+    return _scrollY;
+}
+
+void DMDContainer::setWrap(boolean bWrap)
+{
+    _wrap = bWrap;
+    _dirty = true;
+}
+
+boolean DMDContainer::getWrap()
+{
+    return _wrap;
+}
+
+boolean DMDContainer::isDirty()
+{
+    return _dirty;
+}
+
+void DMDContainer::setDirty(boolean bDirty)
+{
+    _dirty = bDirty;
 }
\ No newline at end of file
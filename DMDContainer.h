@@ -2,12 +2,29 @@
 #define DMD_CONTAINER_H
 
 #include "stdint.h"
+#include "DMDFont.h"
+#include "Arduino.h"
 
+// Off screen pixel area drawn to the display by DMD::drawContainer as a w x h window at x0,y0.
+// The canvas behind the window can be larger, and scrolling only moves the window over it, so
+// text is drawn into the canvas once. Pixels are packed 1bpp as in DMD RAM: most significant
+// bit leftmost, a zero bit is a lit pixel, and every row padded to whole 32 bit words
 class DMDContainer
 {
 public:
     DMDContainer(int16_t x0, int16_t y0, int16_t w, int16_t h);
+    DMDContainer(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t canvasW, int16_t canvasH);
+    ~DMDContainer();
+    // the canvas is owned, a copy would free it twice
+    DMDContainer(const DMDContainer &) = delete;
+    DMDContainer &operator=(const DMDContainer &) = delete;
+    // Packed canvas rows, getStride bytes each. Call setDirty(true) after writing to them directly
     uint8_t *getBufferData();
+    uint16_t getStride();
+    int16_t getCanvasW();
+    int16_t getCanvasH();
+    // 1 when the pixel at x,y of the canvas is lit, 0 when unlit or outside
+    uint8_t getPixel(int16_t x, int16_t y);
     uint8_t appendChar(int16_t x, int16_t y, uint8_t letter);
     uint16_t appendText(int16_t x, int16_t y, const char* text, uint16_t length);
     int16_t getX0();
@@ -19,10 +36,33 @@ public:
     void setFont(const uint8_t *font);
     void clear();
 
+    // Move the container on the display
+    void setPosition(int16_t x0, int16_t y0);
+
+    // Canvas pixel shown at the top left of the window. Outside the canvas is unlit, unless
+    // wrapping, where the canvas repeats in both directions
+    void setScroll(int16_t x, int16_t y);
+    void scrollBy(int16_t dx, int16_t dy);
+    int16_t getScrollX();
+    int16_t getScrollY();
+    void setWrap(boolean bWrap);
+    boolean getWrap();
+
+    // Set by every change to the pixels or position, cleared by DMDCompositor::compose
+    boolean isDirty();
+    void setDirty(boolean bDirty);
+
 private:
+    void init(int16_t x0, int16_t y0, int16_t w, int16_t h, int16_t canvasW, int16_t canvasH);
+
     int16_t _x0, _y0, _w, _h;
+    int16_t _canvasW, _canvasH;
+    int16_t _scrollX, _scrollY;
+    boolean _wrap;
+    uint16_t _stride;
     uint8_t *_buf;
-    const uint8_t *_font;
+    boolean _dirty;
+    DMDFont _font;
 };
 
 #endif
\ No newline at end of file
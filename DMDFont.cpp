@@ -0,0 +1,121 @@
+#include "DMDFont.h"
+#include <cstdlib>
+#include "Arduino.h"
+#include "constants.h"
+
+DMDFont::DMDFont()
+{
+    _font = NULL;
+    _height = 0;
+    _bytes = 0;
+    _firstChar = 0;
+    _charCount = 0;
+    _offsets = NULL;
+    _widths = NULL;
+    _advances = NULL;
+}
+
+DMDFont::~DMDFont()
+{
+    release();
+}
+
+void DMDFont::release()
+{
+    free(_offsets);
+    free(_widths);
+    free(_advances);
+    _offsets = NULL;
+    _widths = NULL;
+    _advances = NULL;
+    _charCount = 0;
+}
+
+void DMDFont::attach(const uint8_t *font)
+{
+    if (font == _font)
+        return;
+
+    release();
+    _font = font;
+    if (_font == NULL)
+        return;
+
+    _height = pgm_read_byte(_font + FONT_HEIGHT);
+    _bytes = (_height + 7) / 8;
+    _firstChar = pgm_read_byte(_font + FONT_FIRST_CHAR);
+    uint8_t charCount = pgm_read_byte(_font + FONT_CHAR_COUNT);
+
+    _offsets = (uint16_t *)malloc(charCount * sizeof(uint16_t));
+    _widths = (uint8_t *)malloc(charCount);
+    _advances = (uint8_t *)calloc(256, 1);
+    if (_offsets == NULL || _widths == NULL || _advances == NULL)
+    {
+        // no font attached, so the next attach of it tries again
+        release();
+        _font = NULL;
+        return;
+    }
+    _charCount = charCount;
+
+    // zero length is flag indicating fixed width font (array does not contain width data entries)
+    bool fixedWidth = pgm_read_byte(_font + FONT_LENGTH) == 0 && pgm_read_byte(_font + FONT_LENGTH + 1) == 0;
+    uint16_t index = 0;
+    for (uint8_t c = 0; c < _charCount; c++)
+    {
+        if (fixedWidth)
+        {
+            _widths[c] = pgm_read_byte(_font + FONT_FIXED_WIDTH);
+            _offsets[c] = c * _bytes * _widths[c] + FONT_WIDTH_TABLE;
+        }
+        else
+        {
+            // variable width font, glyph data follows the width table
+            _widths[c] = pgm_read_byte(_font + FONT_WIDTH_TABLE + c);
+            _offsets[c] = index * _bytes + _charCount + FONT_WIDTH_TABLE;
+            index += _widths[c];
+        }
+        if (_firstChar + c < 256)
+            _advances[_firstChar + c] = _widths[c];
+    }
+    _advances[' '] = getWidth('n');
+}
+
+const uint8_t *DMDFont::getFont()
+{
+    return _font;
+}
+
+uint8_t DMDFont::getHeight()
+{
+    return _height;
+}
+
+uint8_t DMDFont::getBytesPerColumn()
+{
+    return _bytes;
+}
+
+const uint8_t *DMDFont::getGlyph(uint8_t letter)
+{
+    if (letter < _firstChar || letter >= (_firstChar + _charCount))
+        return NULL;
+    return _font + _offsets[letter - _firstChar];
+}
+
+uint8_t DMDFont::getWidth(uint8_t letter)
+{
+    if (letter < _firstChar || letter >= (_firstChar + _charCount))
+        return 0;
+    return _widths[letter - _firstChar];
+}
+
+uint8_t DMDFont::getAdvance(uint8_t letter)
+{
+    return (_advances != NULL) ? _advances[letter] : 0;
+}
+
+const uint8_t *DMDFont::getAdvances()
+{
+    return _advances;
+}
@@ -0,0 +1,42 @@
+#ifndef DMD_FONT_H
+#define DMD_FONT_H
+
+#include "stdint.h"
+
+// Font handle: caches the glyph table of a font in RAM so glyph lookup does not
+// need to sum the flash width table of every earlier glyph
+class DMDFont
+{
+public:
+    DMDFont();
+    ~DMDFont();
+    // the glyph tables are owned, a copy would free them twice
+    DMDFont(const DMDFont &) = delete;
+    DMDFont &operator=(const DMDFont &) = delete;
+    // Build the glyph table for font, a no-op when font is already attached
+    void attach(const uint8_t *font);
+    const uint8_t *getFont();
+    uint8_t getHeight();
+    uint8_t getBytesPerColumn();
+    // Glyph bitmap in flash, NULL when the letter is not in the font
+    const uint8_t *getGlyph(uint8_t letter);
+    // Glyph width in pixels, 0 when the letter is not in the font
+    uint8_t getWidth(uint8_t letter);
+    // Width a letter takes in a line of text: the glyph width, the width of 'n' for a space
+    // (fonts often leave it out), 0 when the letter is not in the font
+    uint8_t getAdvance(uint8_t letter);
+    // The advances of all 256 letters, for measuring text without a call per letter (NULL
+    // when no font is attached)
+    const uint8_t *getAdvances();
+
+private:
+    void release();
+
+    const uint8_t *_font;
+    uint8_t _height, _bytes, _firstChar, _charCount;
+    uint16_t *_offsets;
+    uint8_t *_widths;
+    uint8_t *_advances;
+};
+
+#endif
@@ -0,0 +1,235 @@
+#include "DMDMarquee.h"
+
+DMDMarquee::DMDMarquee(DMD *dmd, int x1, int y1, int x2, int y2)
+{
+    _dmd = dmd;
+    _x1 = x1;
+    _y1 = y1;
+    _x2 = x2;
+    _y2 = y2;
+    _text = NULL;
+    _length = 0;
+    _width = 0;
+    _offsetX = 0;
+    _offsetY = 0;
+    _stepX = -1;
+    _stepY = 0;
+    _every = 1;
+    _frames = 0;
+    _compact = false;
+    _active = true;
+    _next = NULL;
+}
+
+DMDMarquee::~DMDMarquee()
+{
+    free(_text);
+}
+
+void DMDMarquee::selectFont(const uint8_t *font)
+{
+    _font.attach(font);
+}
+
+void DMDMarquee::drawText(const char *text, unsigned int length, int left, int top)
+{
+    char *buf = (char *)realloc(_text, length + 1);
+    if (buf == NULL)
+        length = 0;
+    else
+        _text = buf;
+    _width = 0;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        _text[i] = text[i];
+        _width += _dmd->charWidth(text[i], _font);
+        if (!_compact)
+            _width += 1;
+    }
+    if (_text != NULL)
+        _text[length] = '\0';
+    _length = length;
+    _offsetX = left;
+    _offsetY = top;
+    _clock.restart();
+    redraw();
+}
+
+void DMDMarquee::setStep(int amountX, int amountY, byte every)
+{
+    _stepX = amountX;
+    _stepY = amountY;
+    _every = (every > 0) ? every : 1;
+    _frames = 0;
+}
+
+void DMDMarquee::setSpeed(int32_t speedX, int32_t speedY)
+{
+    _clock.setSpeed(speedX, speedY);
+}
+
+boolean DMDMarquee::update(uint32_t timeUs)
+{
+    int amountX, amountY;
+    if (!_clock.advance(timeUs, amountX, amountY))
+        return false;
+    return step(amountX, amountY);
+}
+
+void DMDMarquee::setCompact(boolean bCompact)
+{
+    _compact = bCompact;
+}
+
+void DMDMarquee::setActive(boolean bActive)
+{
+    _active = bActive;
+    // a marquee set going again does not catch up on the time it was stopped
+    _clock.restart();
+}
+
+boolean DMDMarquee::isActive()
+{
+    return _active;
+}
+
+boolean DMDMarquee::step(int amountX, int amountY)
+{
+    int width = _x2 - _x1 + 1;
+    int height = _y2 - _y1 + 1;
+    boolean ret = false;
+    _offsetX += amountX;
+    _offsetY += amountY;
+    if (_offsetX < -_width)
+    {
+        _offsetX = width;
+        ret = true;
+    }
+    else if (_offsetX > width)
+    {
+        _offsetX = -_width;
+        ret = true;
+    }
+    if (_offsetY < -_font.getHeight())
+    {
+        _offsetY = height;
+        ret = true;
+    }
+    else if (_offsetY > height)
+    {
+        _offsetY = -_font.getHeight();
+        ret = true;
+    }
+    if (ret)
+    {
+        redraw();
+        return true;
+    }
+
+    // move what is in the rectangle and draw only what scrolled into view
+    _dmd->shiftRect(_x1, _y1, _x2, _y2, amountX, amountY);
+    if (amountX < 0)
+        drawArea(_x2 + amountX + 1, _y1, _x2, _y2);
+    else if (amountX > 0)
+        drawArea(_x1, _y1, _x1 + amountX - 1, _y2);
+    if (amountY < 0)
+        drawArea(_x1, _y2 + amountY + 1, _x2, _y2);
+    else if (amountY > 0)
+        drawArea(_x1, _y1, _x2, _y1 + amountY - 1);
+    return false;
+}
+
+void DMDMarquee::redraw()
+{
+    // the zone is ours to clear whatever clip the sketch has set
+    int clipX1, clipY1, clipX2, clipY2;
+    _dmd->getClip(clipX1, clipY1, clipX2, clipY2);
+    _dmd->setClip(_x1, _y1, _x2, _y2);
+    _dmd->fillRect(_x1, _y1, _x2, _y2, GRAPHICS_INVERSE);
+    _dmd->setClip(clipX1, clipY1, clipX2, clipY2);
+    drawArea(_x1, _y1, _x2, _y2);
+}
+
+void DMDMarquee::drawArea(int x1, int y1, int x2, int y2)
+{
+    if (x1 < _x1)
+        x1 = _x1;
+    if (y1 < _y1)
+        y1 = _y1;
+    if (x2 > _x2)
+        x2 = _x2;
+    if (y2 > _y2)
+        y2 = _y2;
+    int top = _y1 + _offsetY;
+    if (x1 > x2 || y1 > y2 || top > y2 || top + _font.getHeight() < y1)
+        return;
+
+    // the area was cleared by the shift, only glyphs are left to draw
+    int clipX1, clipY1, clipX2, clipY2;
+    _dmd->getClip(clipX1, clipY1, clipX2, clipY2);
+    _dmd->setClip(x1, y1, x2, y2);
+    int x = _x1 + _offsetX;
+    for (unsigned int i = 0; i < _length && x <= x2; i++)
+    {
+        int wide = _dmd->charWidth(_text[i], _font);
+        if (wide <= 0)
+            continue;
+        if (_text[i] != ' ' && x + wide - 1 >= x1)
+            _dmd->drawChar(x, top, _text[i], GRAPHICS_NORMAL, _font);
+        x += wide + (_compact ? 0 : 1);
+    }
+    _dmd->setClip(clipX1, clipY1, clipX2, clipY2);
+}
+
+/*--------------------------------------------------------------------------------------
+ DMDMarqueeScheduler, the marquees are kept in a list through DMDMarquee::_next
+--------------------------------------------------------------------------------------*/
+DMDMarqueeScheduler::DMDMarqueeScheduler()
+{
+    _first = NULL;
+}
+
+void DMDMarqueeScheduler::add(DMDMarquee *marquee)
+{
+    remove(marquee);
+    marquee->_next = _first;
+    _first = marquee;
+}
+
+void DMDMarqueeScheduler::remove(DMDMarquee *marquee)
+{
+    for (DMDMarquee **p = &_first; *p != NULL; p = &(*p)->_next)
+    {
+        if (*p == marquee)
+        {
+            *p = marquee->_next;
+            marquee->_next = NULL;
+            return;
+        }
+    }
+}
+
+boolean DMDMarqueeScheduler::step()
+{
+    boolean ret = false;
+    for (DMDMarquee *m = _first; m != NULL; m = m->_next)
+    {
+        if (!m->_active || ++m->_frames < m->_every)
+            continue;
+        m->_frames = 0;
+        if (m->step(m->_stepX, m->_stepY))
+            ret = true;
+    }
+    return ret;
+}
+
+boolean DMDMarqueeScheduler::update(uint32_t timeUs)
+{
+    boolean ret = false;
+    for (DMDMarquee *m = _first; m != NULL; m = m->_next)
+    {
+        if (m->_active && m->update(timeUs))
+            ret = true;
+    }
+    return ret;
+}
@@ -0,0 +1,80 @@
+#ifndef DMD_MARQUEE_H
+#define DMD_MARQUEE_H
+
+#include "DMD32Plus.h"
+
+// A marquee scrolling inside its own rectangle of the display, with its own font, step and
+// spacing. Only the pixels of the rectangle are shifted and drawn, so several marquees and
+// static text can share the display. Step them together with a DMDMarqueeScheduler
+class DMDMarquee
+{
+public:
+    DMDMarquee(DMD *dmd, int x1, int y1, int x2, int y2);
+    ~DMDMarquee();
+
+    void selectFont(const uint8_t *font);
+
+    // Text to scroll, left and top relative to the rectangle
+    void drawText(const char *text, unsigned int length, int left, int top);
+
+    // Pixels moved by the scheduler, once every `every` frames
+    void setStep(int amountX, int amountY, byte every = 1);
+
+    // Speed in pixels per second, 16.16 fixed point (DMD_SPEED), for update
+    void setSpeed(int32_t speedX, int32_t speedY);
+
+    // Move by the whole pixels due at that speed since the last call (timeUs from micros()),
+    // in one step however late the call is. The first call only starts the clock
+    boolean update(uint32_t timeUs);
+
+    // No gap column between glyphs, for Arabic glyph codes from utf8ToArabic
+    void setCompact(boolean bCompact);
+
+    // An inactive marquee is skipped by the scheduler and stays where it is
+    void setActive(boolean bActive);
+    boolean isActive();
+
+    // Move the text across by amount, true when it wraps round to the other side
+    boolean step(int amountX, int amountY);
+
+    // Clear the rectangle and draw the text where it is
+    void redraw();
+
+private:
+    friend class DMDMarqueeScheduler;
+
+    // Draw the characters crossing the part of the rectangle in x1,y1 - x2,y2
+    void drawArea(int x1, int y1, int x2, int y2);
+
+    DMD *_dmd;
+    DMDFont _font;
+    int _x1, _y1, _x2, _y2;
+    char *_text;
+    unsigned int _length;
+    int _width;
+    int _offsetX, _offsetY;
+    int _stepX, _stepY;
+    byte _every, _frames;
+    DMDScrollClock _clock;
+    boolean _compact;
+    boolean _active;
+    DMDMarquee *_next;
+};
+
+// Steps every active marquee added to it, call step() once per frame, or update() to move
+// them at the speed each was given
+class DMDMarqueeScheduler
+{
+public:
+    DMDMarqueeScheduler();
+    void add(DMDMarquee *marquee);
+    void remove(DMDMarquee *marquee);
+    // True when any marquee stepped this frame wrapped round
+    boolean step();
+    boolean update(uint32_t timeUs);
+
+private:
+    DMDMarquee *_first;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include "DMDScanTimer.h"
+#include "Arduino.h"
+
+DMDHwScanTimer::DMDHwScanTimer()
+{
+    _timer = NULL;
+}
+
+bool DMDHwScanTimer::start(uint32_t periodUs, DMDScanCallback callback, void *arg)
+{
+    stop();
+
+    // Create timer with 1MHz frequency
+    _timer = timerBegin(1000000L);
+    if (_timer == NULL)
+        return false;
+    timerAttachInterruptArg(_timer, callback, arg);
+    timerAlarm(_timer, periodUs, true, 0);
+    return true;
+}
+
+void DMDHwScanTimer::stop()
+{
+    if (_timer == NULL)
+        return;
+    timerEnd(_timer);
+    _timer = NULL;
+}
+
+uint32_t IRAM_ATTR DMDHwScanTimer::micros()
+{
+    return ::micros();
+}
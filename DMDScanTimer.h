@@ -0,0 +1,68 @@
+#ifndef DMD_SCAN_TIMER_H
+#define DMD_SCAN_TIMER_H
+
+#include "Arduino.h"
+
+// Fixed cost of one scan besides the SPI transfer (latch, row select, output enable, bookkeeping)
+#define DMD_SCAN_OVERHEAD_US 20
+
+typedef void (*DMDScanCallback)(void *arg);
+
+// Periodic timer driving DMD::beginScanning. The default is an ESP32 hardware timer,
+// a simulated clock can be swapped in with DMD::setScanTimer to test the scheduling on a host
+class DMDScanTimer
+{
+public:
+    virtual ~DMDScanTimer() {}
+    // Call callback(arg) from interrupt context every periodUs microseconds until stop()
+    virtual bool start(uint32_t periodUs, DMDScanCallback callback, void *arg) = 0;
+    virtual void stop() = 0;
+    // Free running microsecond clock used to measure the scans, must be callable from the callback
+    virtual uint32_t micros() = 0;
+};
+
+// Default timer, an ESP32 hardware timer counting at 1 MHz
+class DMDHwScanTimer : public DMDScanTimer
+{
+public:
+    DMDHwScanTimer();
+    bool start(uint32_t periodUs, DMDScanCallback callback, void *arg);
+    void stop();
+    uint32_t micros();
+
+private:
+    hw_timer_t *_timer;
+};
+
+// Time to clock one scan line (16 bytes per panel) out at spiClock Hz, in microseconds
+inline uint32_t dmdScanLineUs(uint8_t displaysTotal, uint32_t spiClock)
+{
+    uint32_t bits = (uint32_t)displaysTotal * 16 * 8;
+    return (uint32_t)(((uint64_t)bits * 1000000UL + spiClock - 1) / spiClock);
+}
+
+// Binary code modulation: every scan line shows bit plane n for 2^n timer ticks,
+// so one scan line takes 2^bitsPerPixel - 1 ticks
+inline uint16_t dmdPlaneTicks(uint8_t plane)
+{
+    return (uint16_t)1 << plane;
+}
+
+inline uint16_t dmdLineTicks(uint8_t bitsPerPixel)
+{
+    return ((uint16_t)1 << bitsPerPixel) - 1;
+}
+
+// Period between scan interrupts for refreshHz full refreshes (4 scan lines each) per second.
+// Never shorter than one scan line takes to send (the on-time of the least significant plane),
+// so the scan cannot starve the main loop
+inline uint32_t dmdScanPeriodUs(uint16_t refreshHz, uint8_t displaysTotal, uint32_t spiClock, uint8_t bitsPerPixel)
+{
+    uint32_t minimum = dmdScanLineUs(displaysTotal, spiClock) + DMD_SCAN_OVERHEAD_US;
+    if (refreshHz == 0)
+        return minimum;
+    uint32_t period = 1000000UL / ((uint32_t)refreshHz * 4 * dmdLineTicks(bitsPerPixel));
+    return (period < minimum) ? minimum : period;
+}
+
+#endif
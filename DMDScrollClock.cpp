@@ -0,0 +1,49 @@
+#include "DMDScrollClock.h"
+
+// one pixel in the units of _accX/_accY
+#define DMD_PIXEL_US (65536LL * 1000000LL)
+
+DMDScrollClock::DMDScrollClock()
+{
+    setSpeed(0, 0);
+}
+
+void DMDScrollClock::setSpeed(int32_t speedX, int32_t speedY)
+{
+    _speedX = speedX;
+    _speedY = speedY;
+    restart();
+}
+
+void DMDScrollClock::restart()
+{
+    _accX = 0;
+    _accY = 0;
+    _lastUs = 0;
+    _running = false;
+}
+
+bool DMDScrollClock::advance(uint32_t timeUs, int &amountX, int &amountY)
+{
+    amountX = 0;
+    amountY = 0;
+    if (!_running)
+    {
+        _running = true;
+        _lastUs = timeUs;
+        return false;
+    }
+
+    // unsigned difference, right across the micros() wrap
+    uint32_t elapsed = timeUs - _lastUs;
+    _lastUs = timeUs;
+    _accX += (int64_t)_speedX * elapsed;
+    _accY += (int64_t)_speedY * elapsed;
+
+    // whole pixels, rounded toward zero so the fraction left has the sign of the speed
+    amountX = (int)(_accX / DMD_PIXEL_US);
+    amountY = (int)(_accY / DMD_PIXEL_US);
+    _accX -= (int64_t)amountX * DMD_PIXEL_US;
+    _accY -= (int64_t)amountY * DMD_PIXEL_US;
+    return amountX != 0 || amountY != 0;
+}
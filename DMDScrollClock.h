@@ -0,0 +1,31 @@
+#ifndef DMD_SCROLL_CLOCK_H
+#define DMD_SCROLL_CLOCK_H
+
+#include "stdint.h"
+
+// Speed in pixels per second as 16.16 fixed point, DMD_SPEED(12.5) is 12.5 pixels a second
+#define DMD_SPEED(pixelsPerSecond) ((int32_t)((pixelsPerSecond) * 65536.0))
+
+// Turns a scroll speed and the time between calls into whole pixel steps. The fraction of a
+// pixel not yet moved is carried over exactly, so the motion keeps to the speed however
+// irregular the calls are, and a late call catches up in one step instead of several
+class DMDScrollClock
+{
+public:
+    DMDScrollClock();
+    void setSpeed(int32_t speedX, int32_t speedY);
+    // The next advance only starts the clock
+    void restart();
+    // Pixels to move for the time since the last call, timeUs from micros(). False when
+    // there is nothing to move
+    bool advance(uint32_t timeUs, int &amountX, int &amountY);
+
+private:
+    int32_t _speedX, _speedY;
+    // moved so far but not yet stepped, in 1/65536 pixel microseconds per second
+    int64_t _accX, _accY;
+    uint32_t _lastUs;
+    bool _running;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "DMDShapeCache.h"
+#include <cstring>
+#include <cstdlib>
+
+DMDShapeCache::DMDShapeCache(uint8_t entries)
+{
+    _entries = (Entry *)calloc(entries, sizeof(Entry));
+    _count = (_entries != NULL) ? entries : 0;
+    _clock = 0;
+    _hits = 0;
+    _misses = 0;
+}
+
+DMDShapeCache::~DMDShapeCache()
+{
+    clear();
+    free(_entries);
+}
+
+// FNV-1a, with the length of the text on the way
+uint32_t DMDShapeCache::hashText(const char *utf8Text, unsigned int &textLength)
+{
+    uint32_t hash = 2166136261u;
+    const uint8_t *p = (const uint8_t *)utf8Text;
+    for (; *p; p++)
+        hash = (hash ^ *p) * 16777619u;
+    textLength = p - (const uint8_t *)utf8Text;
+    return hash;
+}
+
+const DMDShapedRun *DMDShapeCache::find(const char *utf8Text, const uint8_t *font)
+{
+    unsigned int textLength;
+    uint32_t hash = hashText(utf8Text, textLength);
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        Entry &e = _entries[i];
+        if (e.text != NULL && e.hash == hash && e.font == font && e.textLength == textLength &&
+            memcmp(e.text, utf8Text, textLength) == 0)
+        {
+            e.lastUsed = ++_clock;
+            _hits++;
+            return &e.run;
+        }
+    }
+    _misses++;
+    return NULL;
+}
+
+const DMDShapedRun *DMDShapeCache::insert(const char *utf8Text, const uint8_t *font, const char *glyphs, unsigned int length, int width)
+{
+    if (_count == 0)
+        return NULL;
+    // an empty entry, or else the least recently used
+    Entry *e = &_entries[0];
+    for (uint8_t i = 0; i < _count && e->text != NULL; i++)
+    {
+        if (_entries[i].text == NULL || _entries[i].lastUsed < e->lastUsed)
+            e = &_entries[i];
+    }
+
+    unsigned int textLength;
+    uint32_t hash = hashText(utf8Text, textLength);
+    char *text = (char *)realloc(e->text, textLength + length + 1);
+    if (text == NULL)
+        return NULL;
+    memcpy(text, utf8Text, textLength);
+    memcpy(text + textLength, glyphs, length);
+    text[textLength + length] = '\0';
+
+    e->text = text;
+    e->textLength = textLength;
+    e->hash = hash;
+    e->font = font;
+    e->lastUsed = ++_clock;
+    e->run.glyphs = text + textLength;
+    e->run.length = length;
+    e->run.width = width;
+    return &e->run;
+}
+
+void DMDShapeCache::clear()
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        free(_entries[i].text);
+        _entries[i].text = NULL;
+    }
+    _clock = 0;
+    _hits = 0;
+    _misses = 0;
+}
+
+uint32_t DMDShapeCache::getHits()
+{
+    return _hits;
+}
+
+uint32_t DMDShapeCache::getMisses()
+{
+    return _misses;
+}
@@ -0,0 +1,58 @@
+#ifndef DMD_SHAPE_CACHE_H
+#define DMD_SHAPE_CACHE_H
+
+#include "stdint.h"
+
+// Arabic text shaped once by DMD: the glyphs in visual order and their width in pixels
+struct DMDShapedRun
+{
+    const char *glyphs;
+    unsigned int length;
+    int width;
+};
+
+// Least recently used cache of shaped Arabic text for DMD::setShapeCache, keyed by a hash of
+// the UTF-8 text and the font. Signage cycling through a set of phrases then decodes, shapes
+// and reverses each phrase once instead of on every drawArabicString or drawArabicMarquee.
+// The text is kept to confirm a hash match, so a collision can not draw the wrong phrase
+class DMDShapeCache
+{
+public:
+    // Room for entries phrases, the least recently used one is replaced when full
+    DMDShapeCache(uint8_t entries);
+    ~DMDShapeCache();
+    // the entries and their text are owned, a copy would free them twice
+    DMDShapeCache(const DMDShapeCache &) = delete;
+    DMDShapeCache &operator=(const DMDShapeCache &) = delete;
+
+    // The run shaped for utf8Text with font, NULL (a miss) when it is not cached
+    const DMDShapedRun *find(const char *utf8Text, const uint8_t *font);
+    // Cache a copy of the run shaped for utf8Text with font, NULL when out of memory
+    const DMDShapedRun *insert(const char *utf8Text, const uint8_t *font, const char *glyphs, unsigned int length, int width);
+    // Drop every entry, and the hit and miss counts
+    void clear();
+
+    uint32_t getHits();
+    uint32_t getMisses();
+
+private:
+    struct Entry
+    {
+        DMDShapedRun run;
+        uint32_t hash;
+        const uint8_t *font;
+        // the UTF-8 text, then the glyphs, in one allocation
+        char *text;
+        unsigned int textLength;
+        uint32_t lastUsed;
+    };
+
+    static uint32_t hashText(const char *utf8Text, unsigned int &textLength);
+
+    Entry *_entries;
+    uint8_t _count;
+    uint32_t _clock;
+    uint32_t _hits, _misses;
+};
+
+#endif
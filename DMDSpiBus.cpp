@@ -0,0 +1,45 @@
+#include "DMDSpiBus.h"
+#include "Arduino.h"
+#include <SPI.h>
+
+DMDVSPIBus::DMDVSPIBus(uint32_t clock)
+{
+    _spi = NULL;
+    _clock = clock;
+}
+
+DMDVSPIBus::~DMDVSPIBus()
+{
+    if (_spi == NULL)
+        return;
+    _spi->end();
+    delete _spi;
+}
+
+void DMDVSPIBus::begin(uint8_t clkPin, uint8_t dataPin)
+{
+    // initialise instance of the SPIClass attached to vspi
+    _spi = new SPIClass(VSPI);
+    _spi->begin(clkPin, -1, dataPin, -1);
+}
+
+void IRAM_ATTR DMDVSPIBus::beginTransaction()
+{
+    _spi->beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+}
+
+void IRAM_ATTR DMDVSPIBus::transfer(uint8_t data)
+{
+    _spi->transfer(data);
+}
+
+void IRAM_ATTR DMDVSPIBus::writeBytes(const uint8_t *data, uint32_t length)
+{
+    // SPIClass::writeBytes feeds the hardware FIFO in 64 byte bursts without reading back
+    _spi->writeBytes(data, length);
+}
+
+void IRAM_ATTR DMDVSPIBus::endTransaction()
+{
+    _spi->endTransaction();
+}
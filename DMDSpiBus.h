@@ -0,0 +1,41 @@
+#ifndef DMD_SPI_BUS_H
+#define DMD_SPI_BUS_H
+
+#include "stdint.h"
+
+class SPIClass;
+
+// Bus the scan path clocks pixel data out on. DMD only talks to the panels through
+// this interface, so the bus can be replaced (e.g. by a DMA backed driver, or a mock
+// recording the byte stream on a host build) with DMD::setSpiBus()
+class DMDSpiBus
+{
+public:
+    virtual ~DMDSpiBus() {}
+    virtual void begin(uint8_t clkPin, uint8_t dataPin) = 0;
+    virtual void beginTransaction() = 0;
+    virtual void transfer(uint8_t data) = 0;
+    // Clock out a whole buffer inside one transaction
+    virtual void writeBytes(const uint8_t *data, uint32_t length) = 0;
+    virtual void endTransaction() = 0;
+};
+
+// Default bus, the ESP32 VSPI port through the Arduino SPI library
+class DMDVSPIBus : public DMDSpiBus
+{
+public:
+    DMDVSPIBus(uint32_t clock);
+    // Releases the SPI port, so another bus can begin on the same pins
+    ~DMDVSPIBus();
+    void begin(uint8_t clkPin, uint8_t dataPin);
+    void beginTransaction();
+    void transfer(uint8_t data);
+    void writeBytes(const uint8_t *data, uint32_t length);
+    void endTransaction();
+
+private:
+    SPIClass *_spi;
+    uint32_t _clock;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "DMDTextSource.h"
+#include "DMDBidi.h"
+#include <cstring>
+#include <cstdlib>
+
+/*--------------------------------------------------------------------------------------
+ DMDStringSource
+--------------------------------------------------------------------------------------*/
+DMDStringSource::DMDStringSource(const char *text)
+{
+    _text = text;
+    _length = (text != NULL) ? strlen(text) : 0;
+    _pos = 0;
+}
+
+DMDStringSource::DMDStringSource(const char *text, size_t length)
+{
+    _text = text;
+    _length = length;
+    _pos = 0;
+}
+
+int DMDStringSource::next()
+{
+    if (_pos >= _length)
+        return DMD_TEXT_END;
+    return (uint8_t)_text[_pos++];
+}
+
+bool DMDStringSource::rewind()
+{
+    _pos = 0;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ DMDRingSource. One slot is kept free so _head == _tail means empty; the writer only
+ moves _head and the reader only _tail, each stored with release after its data access and
+ loaded by the other side with acquire, so the two can run on different cores
+--------------------------------------------------------------------------------------*/
+DMDRingSource::DMDRingSource(size_t size)
+{
+    _size = size + 1;
+    _buf = (char *)malloc(_size);
+    if (_buf == NULL)
+        _size = 0;
+    _head = 0;
+    _tail = 0;
+    _closed = false;
+}
+
+DMDRingSource::~DMDRingSource()
+{
+    free(_buf);
+}
+
+size_t DMDRingSource::space()
+{
+    if (_size == 0)
+        return 0;
+    // acquire: next has finished reading the bytes it freed before they are written over
+    size_t tail = _tail.load(std::memory_order_acquire);
+    return (tail + _size - _head.load(std::memory_order_relaxed) - 1) % _size;
+}
+
+size_t DMDRingSource::write(const char *text, size_t length)
+{
+    size_t room = space();
+    if (length > room)
+        length = room;
+    size_t head = _head.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < length; i++)
+    {
+        _buf[head] = text[i];
+        head = (head + 1 == _size) ? 0 : head + 1;
+    }
+    // release: the bytes are in the buffer before the reader can see the new head
+    _head.store(head, std::memory_order_release);
+    return length;
+}
+
+size_t DMDRingSource::write(const char *text)
+{
+    return write(text, strlen(text));
+}
+
+void DMDRingSource::close()
+{
+    _closed.store(true, std::memory_order_release);
+}
+
+int DMDRingSource::next()
+{
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire))
+    {
+        if (!_closed.load(std::memory_order_acquire))
+            return DMD_TEXT_PENDING;
+        // a write just before close may not have been seen above
+        if (tail == _head.load(std::memory_order_acquire))
+            return DMD_TEXT_END;
+    }
+    int c = (uint8_t)_buf[tail];
+    _tail.store((tail + 1 == _size) ? 0 : tail + 1, std::memory_order_release);
+    return c;
+}
+
+/*--------------------------------------------------------------------------------------
+ DMDArabicSource. UTF-8 is decoded a byte at a time and each codepoint pushed through the
+ shaper, which hands back the glyph of the one before.
+
+ In a right to left paragraph Arabic letters, and spaces with nothing but Arabic letters
+ before them, are always at level 1, and the levels of the text up to an Arabic letter do not
+ depend on what follows it. So the glyphs from the first other one up to the next Arabic
+ letter are resolved on their own, after the class of the last strong glyph before them
+ (which rule W2 and W7 look back to), and handed out from the right of their visual order.
+--------------------------------------------------------------------------------------*/
+DMDArabicSource::DMDArabicSource(DMDTextSource *utf8)
+{
+    _utf8 = utf8;
+    _ended = false;
+    _runLength = 0;
+    _runOut = 0;
+    _held = 0;
+    _context = DMD_BIDI_R;
+}
+
+int DMDArabicSource::next()
+{
+    if (_runOut > 0)
+        return (uint8_t)_run[--_runOut];
+    if (_held != 0)
+    {
+        int glyph = _held;
+        _held = 0;
+        return glyph;
+    }
+
+    for (;;)
+    {
+        int glyph = nextGlyph();
+        if (glyph == DMD_TEXT_PENDING)
+            return DMD_TEXT_PENDING;
+        if (glyph == DMD_TEXT_END)
+        {
+            if (_runLength == 0)
+                return DMD_TEXT_END;
+            orderRun();
+            return (uint8_t)_run[--_runOut];
+        }
+
+        uint8_t type = DMDBidi::glyphClass(glyph);
+        if (type == DMD_BIDI_AL)
+        {
+            if (_runLength == 0)
+            {
+                _context = DMD_BIDI_AL;
+                return glyph;
+            }
+            orderRun();
+            _context = DMD_BIDI_AL;
+            _held = glyph;
+            return (uint8_t)_run[--_runOut];
+        }
+        if (_runLength == 0 && type == DMD_BIDI_WS && _context != DMD_BIDI_L)
+            return glyph;
+
+        _run[_runLength++] = glyph;
+        if (_runLength == DMD_ARABIC_SOURCE_RUN)
+        {
+            orderRun();
+            return (uint8_t)_run[--_runOut];
+        }
+    }
+}
+
+// Put the run in visual order after _context, to be handed out from its end
+void DMDArabicSource::orderRun()
+{
+    uint8_t classes[DMD_ARABIC_SOURCE_RUN + 1];
+    uint8_t levels[DMD_ARABIC_SOURCE_RUN + 1];
+    classes[0] = _context;
+    for (uint8_t i = 0; i < _runLength; i++)
+    {
+        classes[i + 1] = DMDBidi::glyphClass((uint8_t)_run[i]);
+        // a run cut short carries its last strong class on to the next piece
+        if (classes[i + 1] == DMD_BIDI_L)
+            _context = DMD_BIDI_L;
+    }
+    DMDBidi::resolve(classes, _runLength + 1, 1, levels);
+    DMDBidi::reorder(_run, levels + 1, _runLength);
+    _runOut = _runLength;
+    _runLength = 0;
+}
+
+int DMDArabicSource::nextGlyph()
+{
+    while (!_ended)
+    {
+        int b = _utf8->next();
+        if (b == DMD_TEXT_PENDING)
+            return DMD_TEXT_PENDING;
+
+        uint8_t glyph;
+        uint32_t codepoint;
+        if (b < 0)
+        {
+            // flush the last letter, its form no longer waits on a next one
+            _ended = true;
+            glyph = _decoder.finish(codepoint) ? _shaper.push(codepoint) : 0;
+            if (glyph == 0)
+                glyph = _shaper.push(0);
+        }
+        else
+        {
+            uint8_t result = _decoder.push(b, codepoint);
+            if (result == DMD_UTF8_MORE || codepoint == 0)
+                continue;
+            glyph = _shaper.push(codepoint);
+            // U+FFFD has no glyph, so pushing the byte's own codepoint after it gives nothing more
+            if (result == DMD_UTF8_AGAIN && _decoder.push(b, codepoint) == DMD_UTF8_DONE && codepoint != 0)
+                _shaper.push(codepoint);
+        }
+        if (glyph != 0)
+            return glyph;
+    }
+    return DMD_TEXT_END;
+}
+
+bool DMDArabicSource::rewind()
+{
+    if (!_utf8->rewind())
+        return false;
+    _shaper.reset();
+    _decoder.reset();
+    _ended = false;
+    _runLength = 0;
+    _runOut = 0;
+    _held = 0;
+    _context = DMD_BIDI_R;
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef DMD_TEXT_SOURCE_H
+#define DMD_TEXT_SOURCE_H
+
+#include "stdint.h"
+#include "stddef.h"
+#include <atomic>
+#include "DMDArabic.h"
+#include "DMDUtf8.h"
+
+#define DMD_TEXT_END -1     // the text is over
+#define DMD_TEXT_PENDING -2 // nothing to read yet, ask again on a later step
+// glyphs of a left to right run DMDArabicSource holds back to put in order
+#define DMD_ARABIC_SOURCE_RUN 64
+
+// Text a streamed marquee (DMD::drawMarquee(DMDTextSource *, ...)) pulls a character at a
+// time as it scrolls into view, so the marquee never holds more than what is on screen
+class DMDTextSource
+{
+public:
+    virtual ~DMDTextSource() {}
+    // Next character (a glyph code of the marquee font), DMD_TEXT_END or DMD_TEXT_PENDING
+    virtual int next() = 0;
+    // Start the text again once it has scrolled off, false if it cannot be
+    virtual bool rewind() { return false; }
+};
+
+// Text of any length already in memory (RAM or flash), read in place
+class DMDStringSource : public DMDTextSource
+{
+public:
+    DMDStringSource(const char *text);
+    DMDStringSource(const char *text, size_t length);
+    int next();
+    bool rewind();
+
+private:
+    const char *_text;
+    size_t _length;
+    size_t _pos;
+};
+
+// Text written while it scrolls (from Serial, the network...) into a ring buffer of size
+// bytes. One task may write while another, on either core, steps the marquee (one writer and
+// one reader); write returns how much fitted
+class DMDRingSource : public DMDTextSource
+{
+public:
+    DMDRingSource(size_t size);
+    ~DMDRingSource();
+    size_t write(const char *text, size_t length);
+    size_t write(const char *text);
+    // Room left for write
+    size_t space();
+    // The text ends once everything written so far has been read
+    void close();
+    int next();
+
+private:
+    char *_buf;
+    size_t _size;
+    // _head is only stored by write, _tail only by next
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    std::atomic<bool> _closed;
+};
+
+// UTF-8 text from another source, shaped into fonts/ArabicFont.h glyph codes as it is read.
+// The glyphs come in visual order read from the right, scroll them with bRightToLeft set.
+// Arabic letters and spaces pass straight through, a run of Latin letters and numbers is held
+// back until the Arabic letter after it (or the end of the text) and put in order by DMDBidi,
+// as drawArabicString would. A run longer than DMD_ARABIC_SOURCE_RUN glyphs is ordered in pieces
+class DMDArabicSource : public DMDTextSource
+{
+public:
+    DMDArabicSource(DMDTextSource *utf8);
+    int next();
+    bool rewind();
+
+private:
+    int nextGlyph();
+    void orderRun();
+
+    DMDTextSource *_utf8;
+    DMDArabicShaper _shaper;
+    DMDUtf8Decoder _decoder;
+    bool _ended;
+    // the run held back, handed out from the end once ordered
+    char _run[DMD_ARABIC_SOURCE_RUN];
+    uint8_t _runLength;
+    uint8_t _runOut;
+    // the Arabic letter that ended the run, and the last strong class before the run
+    int _held;
+    uint8_t _context;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "DMDUtf8.h"
+#include <cstring>
+
+DMDUtf8Decoder::DMDUtf8Decoder()
+{
+    _errors = 0;
+    reset();
+}
+
+void DMDUtf8Decoder::reset()
+{
+    _codepoint = 0;
+    _pending = 0;
+    _lower = 0x80;
+    _upper = 0xBF;
+}
+
+uint8_t DMDUtf8Decoder::push(uint8_t byte, uint32_t &codepoint)
+{
+    if (_pending == 0)
+    {
+        if (byte < 0x80)
+        {
+            codepoint = byte;
+            return DMD_UTF8_DONE;
+        }
+        // a lead byte sets the payload bits, the continuation bytes to come and the range of
+        // the first of them, narrowed where the shortest form or the surrogates would be broken
+        if (byte >= 0xC2 && byte <= 0xDF)
+        {
+            _codepoint = byte & 0x1F;
+            _pending = 1;
+        }
+        else if (byte >= 0xE0 && byte <= 0xEF)
+        {
+            _codepoint = byte & 0x0F;
+            _pending = 2;
+            if (byte == 0xE0)
+                _lower = 0xA0; // below U+0800
+            else if (byte == 0xED)
+                _upper = 0x9F; // surrogates U+D800-U+DFFF
+        }
+        else if (byte >= 0xF0 && byte <= 0xF4)
+        {
+            _codepoint = byte & 0x07;
+            _pending = 3;
+            if (byte == 0xF0)
+                _lower = 0x90; // below U+10000
+            else if (byte == 0xF4)
+                _upper = 0x8F; // beyond U+10FFFF
+        }
+        else
+        {
+            // a continuation byte with no lead, C0/C1 (always overlong) or F5-FF
+            _errors++;
+            codepoint = DMD_UTF8_REPLACEMENT;
+            return DMD_UTF8_DONE;
+        }
+        return DMD_UTF8_MORE;
+    }
+
+    if (byte < _lower || byte > _upper)
+    {
+        // the bytes so far are one invalid sequence, this byte starts whatever comes next
+        reset();
+        _errors++;
+        codepoint = DMD_UTF8_REPLACEMENT;
+        return DMD_UTF8_AGAIN;
+    }
+    _codepoint = (_codepoint << 6) | (byte & 0x3F);
+    _lower = 0x80;
+    _upper = 0xBF;
+    if (--_pending > 0)
+        return DMD_UTF8_MORE;
+    codepoint = _codepoint;
+    return DMD_UTF8_DONE;
+}
+
+bool DMDUtf8Decoder::finish(uint32_t &codepoint)
+{
+    if (_pending == 0)
+        return false;
+    reset();
+    _errors++;
+    codepoint = DMD_UTF8_REPLACEMENT;
+    return true;
+}
+
+unsigned int DMDUtf8Decoder::getErrors()
+{
+    return _errors;
+}
+
+DMDUtf8Iterator::DMDUtf8Iterator(const char *text)
+{
+    _pos = (const uint8_t *)text;
+    _end = _pos + strlen(text);
+}
+
+DMDUtf8Iterator::DMDUtf8Iterator(const char *text, unsigned int length)
+{
+    _pos = (const uint8_t *)text;
+    _end = _pos + length;
+}
+
+bool DMDUtf8Iterator::nextSequence(uint32_t &codepoint)
+{
+    // two byte sequences (Arabic, Hebrew, Latin accents) are checked whole
+    if (_pos[0] >= 0xC2 && _pos[0] <= 0xDF && _end - _pos >= 2 && (_pos[1] & 0xC0) == 0x80)
+    {
+        codepoint = ((uint32_t)(_pos[0] & 0x1F) << 6) | (_pos[1] & 0x3F);
+        _pos += 2;
+        return true;
+    }
+    while (_pos != _end)
+    {
+        uint8_t result = _decoder.push(*_pos, codepoint);
+        if (result == DMD_UTF8_AGAIN)
+            return true;
+        _pos++;
+        if (result == DMD_UTF8_DONE)
+            return true;
+    }
+    // the text ends inside a sequence
+    return _decoder.finish(codepoint);
+}
+
+const char *DMDUtf8Iterator::position()
+{
+    return (const char *)_pos;
+}
+
+unsigned int DMDUtf8Iterator::getErrors()
+{
+    return _decoder.getErrors();
+}
+
+unsigned int dmdAsciiPrefix(const char *text, unsigned int length)
+{
+    unsigned int i = 0;
+    // a byte sets bit 7 of its lane when it is 0x80 or above, wraps below 0x20 when 0x20 is
+    // taken away, or reaches 0x80 when 1 is added to 0x7F. Carries between lanes only come
+    // from a lane that is already flagged
+    for (; i + 8 <= length; i += 8)
+    {
+        uint32_t a, b;
+        memcpy(&a, text + i, 4);
+        memcpy(&b, text + i + 4, 4);
+        uint32_t flags = a | (a - 0x20202020u) | (a + 0x01010101u) | b | (b - 0x20202020u) | (b + 0x01010101u);
+        if (flags & 0x80808080u)
+            break;
+    }
+    while (i < length && (uint8_t)text[i] >= 0x20 && (uint8_t)text[i] <= 0x7E)
+        i++;
+    return i;
+}
@@ -0,0 +1,76 @@
+#ifndef DMD_UTF8_H
+#define DMD_UTF8_H
+
+#include "stdint.h"
+
+// Codepoint given for every invalid sequence
+#define DMD_UTF8_REPLACEMENT 0xFFFD
+
+// Results of DMDUtf8Decoder::push
+#define DMD_UTF8_MORE 0  // the byte is part of a sequence that is not complete yet
+#define DMD_UTF8_DONE 1  // a codepoint is complete, U+FFFD for an invalid byte
+#define DMD_UTF8_AGAIN 2 // the sequence before the byte was invalid (U+FFFD), push the byte again
+
+// Validating UTF-8 decoder fed one byte at a time, for text that arrives a byte at a time.
+// Only the well formed sequences of Unicode table 3-7 decode: overlong forms, surrogates and
+// codepoints beyond U+10FFFF are invalid. Every maximal part of an invalid sequence gives one
+// U+FFFD, as Unicode recommends, so a broken sequence never swallows the character after it
+class DMDUtf8Decoder
+{
+public:
+    DMDUtf8Decoder();
+    void reset();
+
+    // Feed the next byte, see DMD_UTF8_MORE, DMD_UTF8_DONE and DMD_UTF8_AGAIN
+    uint8_t push(uint8_t byte, uint32_t &codepoint);
+    // The text is over: true with U+FFFD in codepoint when it ended inside a sequence
+    bool finish(uint32_t &codepoint);
+
+    // Invalid sequences met since the decoder was made
+    unsigned int getErrors();
+
+private:
+    uint32_t _codepoint;
+    uint8_t _pending;      // continuation bytes still to come
+    uint8_t _lower, _upper; // range of the next continuation byte
+    unsigned int _errors;
+};
+
+// Codepoints of UTF-8 text read in place, without copying it. ASCII bytes are taken straight
+// from the text, other bytes go through a DMDUtf8Decoder, which is left between sequences
+class DMDUtf8Iterator
+{
+public:
+    // NUL terminated text
+    DMDUtf8Iterator(const char *text);
+    DMDUtf8Iterator(const char *text, unsigned int length);
+
+    // The next codepoint, false at the end of the text
+    inline bool next(uint32_t &codepoint)
+    {
+        if (_pos == _end)
+            return false;
+        if (*_pos < 0x80)
+        {
+            codepoint = *_pos++;
+            return true;
+        }
+        return nextSequence(codepoint);
+    }
+
+    // The byte the next codepoint starts at
+    const char *position();
+    unsigned int getErrors();
+
+private:
+    bool nextSequence(uint32_t &codepoint);
+
+    const uint8_t *_pos, *_end;
+    DMDUtf8Decoder _decoder;
+};
+
+// Number of bytes at the start of text that are printable ASCII (0x20-0x7E), tested a 32 bit
+// word at a time. Text of printable ASCII alone draws as it is, with no decoding or shaping
+unsigned int dmdAsciiPrefix(const char *text, unsigned int length);
+
+#endif
@@ -14,18 +14,10 @@
 #define DISPLAYS_DOWN 1
 DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN);
 
-hw_timer_t *timer = NULL;
-
-void IRAM_ATTR triggerScan()
-{
-  dmd.scanDisplayBySPI();
-}
-
 void setup(void)
 {
-  timer = timerBegin(1000000L);
-  timerAttachInterrupt(timer, &triggerScan);
-  timerAlarm(timer, 1000, true, 0);
+  // scan the display from a hardware timer, 250 full refreshes per second (a scan line every 1ms)
+  dmd.beginScanning(250);
 
   dmd.clearScreen(true);
   dmd.selectFont(ArabicFont);
@@ -27,20 +27,8 @@ configuration).
 
 DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN, OE_PIN, A_PIN, B_PIN, CLK_PIN, LAT_PIN, R_DATA_PIN);
 
-// Timer setup
-// create a hardware timer  of ESP32
-hw_timer_t *timer = NULL;
-
 char text[] = "Hello World!";
 
-/*--------------------------------------------------------------------------------------
-  Interrupt handler for timer driven DMD refresh scanning, this gets
-  called at the period set in timerAlarm;
---------------------------------------------------------------------------------------*/
-void IRAM_ATTR triggerScan() {
-  dmd.scanDisplayBySPI();
-}
-
 /*--------------------------------------------------------------------------------------
   setup
   Called by the Arduino architecture before the main loop begins
@@ -48,14 +36,8 @@ void IRAM_ATTR triggerScan() {
 void setup(void) {
   Serial.begin(115200);
 
-  // Create timer with 1MHz frequency
-  timer = timerBegin(1000000L);  // 1MHz
-
-  // Attach interrupt to the timer
-  timerAttachInterrupt(timer, &triggerScan);
-
-  // Set alarm to the timer every 1000 ticks (1ms), then repeat 
-  timerAlarm(timer, 1000, true, 0);
+  // Scan the display from a hardware timer, 250 full refreshes per second (a scan line every 1ms)
+  dmd.beginScanning(250);
 
   // clear/init the DMD pixels held in RAM
   dmd.clearScreen(true);  // true is normal (all pixels off), false is negative (all pixels on)
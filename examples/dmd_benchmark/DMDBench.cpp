@@ -0,0 +1,424 @@
+#include "DMDBench.h"
+#include <stdio.h>
+#include <string.h>
+#include <DMD32Plus.h>
+#include <DMDContainer.h>
+#include <utils.h>
+#include "fonts/SystemFont5x7.h"
+#include "fonts/Arial14.h"
+#include "fonts/Arial_38b.h"
+#include "fonts/Arial_Black21.h"
+#include "fonts/Arial_Black_16_ISO_8859_1.h"
+#include "fonts/Arial_black_16.h"
+#include "fonts/BodoniMTBlack24.h"
+#include "fonts/Comic24.h"
+#include "fonts/Droid_Sans_24.h"
+#include "fonts/ArabicFont.h"
+
+struct BenchFont
+{
+  const char *name;
+  const uint8_t *data;
+};
+
+// Tahoma_32 is left out, DMD cannot draw its format
+static const BenchFont benchFonts[] = {
+    {"SystemFont5x7", System5x7},
+    {"Arial_14", Arial_14},
+    {"Arial_38b", Arial_38b},
+    {"Arial_Black21", Arial_Black21},
+    {"Arial_Black_16_ISO_8859_1", Arial_Black_16_ISO_8859_1},
+    {"Arial_Black_16", Arial_Black_16},
+    {"BodoniMTBlack24", BodoniMTBlack24},
+    {"Comic24", Comic24},
+    {"Droid_Sans_24", Droid_Sans_24},
+    {"ArabicFont", ArabicFont},
+};
+
+struct BenchMode
+{
+  const char *name;
+  byte mode;
+};
+
+static const BenchMode benchModes[] = {
+    {"NORMAL", GRAPHICS_NORMAL},
+    {"INVERSE", GRAPHICS_INVERSE},
+    {"TOGGLE", GRAPHICS_TOGGLE},
+    {"OR", GRAPHICS_OR},
+    {"NOR", GRAPHICS_NOR},
+};
+
+static const byte benchGrids[][2] = {{1, 1}, {2, 1}, {4, 2}, {8, 4}};
+
+static const char latinText[] = "The quick brown fox 0123456789";
+// "Welcome to Morocco" in Arabic
+static const char arabicText[] = "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 \xd8\xa8\xd9\x83\xd9\x85 \xd9\x81\xd9\x8a "
+                                 "\xd8\xa7\xd9\x84\xd9\x85\xd8\xba\xd8\xb1\xd8\xa8";
+
+#define BENCH_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static const DMDBenchPlatform *bench;
+static uint64_t benchMinNs;
+static const char *benchFilter;
+static boolean benchFirst;
+
+// One DMD and one display sized container per grid, kept from run to run
+static DMD *benchDisplays[BENCH_COUNT(benchGrids)];
+static DMDContainer *benchContainers[BENCH_COUNT(benchGrids)];
+static DMDFixed<2, 1> *benchFixed;
+
+static DMD *benchDisplay(byte grid)
+{
+  if (benchDisplays[grid] == NULL)
+    benchDisplays[grid] = new DMD(benchGrids[grid][0], benchGrids[grid][1]);
+  return benchDisplays[grid];
+}
+
+static boolean benchSelected(const char *name)
+{
+  return benchFilter == NULL || strstr(name, benchFilter) != NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ Time op(i) for i = 0, 1, 2... in batches doubling in size until the minimum time has
+ passed, and write the result
+--------------------------------------------------------------------------------------*/
+template <typename Op>
+static void benchCase(const char *name, const char *font, const char *mode, byte grid, Op op)
+{
+  uint32_t ops = 0, batch = 1;
+  uint64_t ns = 0, cycles = 0;
+
+  op(0);
+  do
+  {
+    uint64_t c0 = bench->nowCycles ? bench->nowCycles() : 0;
+    uint64_t t0 = bench->nowNs();
+    for (uint32_t i = 0; i < batch; i++)
+      op(ops + i);
+    ns += bench->nowNs() - t0;
+    cycles += bench->nowCycles ? bench->nowCycles() - c0 : 0;
+    ops += batch;
+    if (batch < 65536)
+      batch <<= 1;
+  } while (ns < benchMinNs);
+
+  char line[256];
+  snprintf(line, sizeof(line),
+           "%s\n {\"name\":\"%s\",\"font\":\"%s\",\"mode\":\"%s\",\"grid\":\"%dx%d\",\"ops\":%lu,"
+           "\"ns_per_op\":%.1f,\"cycles_per_op\":%.1f}",
+           benchFirst ? "" : ",", name, font ? font : "", mode ? mode : "",
+           benchGrids[grid][0], benchGrids[grid][1], (unsigned long)ops,
+           (double)ns / ops, (double)cycles / ops);
+  benchFirst = false;
+  bench->write(line);
+}
+
+/*--------------------------------------------------------------------------------------
+ Cases
+--------------------------------------------------------------------------------------*/
+static void benchWritePixel()
+{
+  if (!benchSelected("writePixel"))
+    return;
+  for (byte m = 0; m < BENCH_COUNT(benchModes); m++)
+  {
+    DMD *dmd = benchDisplay(1);
+    byte mode = benchModes[m].mode;
+    dmd->clearScreen(true);
+    benchCase("writePixel", NULL, benchModes[m].name, 1, [=](uint32_t i)
+              { dmd->writePixel((i * 7) & 63, (i * 3) & 15, mode, i & 1); });
+  }
+  // the same 2x1 grid fixed at compile time
+  if (benchFixed == NULL)
+    benchFixed = new DMDFixed<2, 1>();
+  DMDFixed<2, 1> *fixed = benchFixed;
+  for (byte m = 0; m < BENCH_COUNT(benchModes); m++)
+  {
+    byte mode = benchModes[m].mode;
+    fixed->clearScreen(true);
+    benchCase("writePixelFixed", NULL, benchModes[m].name, 1, [=](uint32_t i)
+              { fixed->writePixelFixed((i * 7) & 63, (i * 3) & 15, mode, i & 1); });
+  }
+}
+
+static void benchDrawChar()
+{
+  if (!benchSelected("drawChar"))
+    return;
+  for (byte f = 0; f < BENCH_COUNT(benchFonts); f++)
+  {
+    DMD *dmd = benchDisplay(1);
+    dmd->selectFont(benchFonts[f].data);
+    byte first = pgm_read_byte(benchFonts[f].data + FONT_FIRST_CHAR);
+    byte count = pgm_read_byte(benchFonts[f].data + FONT_CHAR_COUNT);
+    for (byte m = 0; m < BENCH_COUNT(benchModes); m++)
+    {
+      byte mode = benchModes[m].mode;
+      dmd->clearScreen(true);
+      benchCase("drawChar", benchFonts[f].name, benchModes[m].name, 1, [=](uint32_t i)
+                { dmd->drawChar((i * 5) % 48, 0, first + (i % count), mode); });
+    }
+  }
+}
+
+static void benchDrawString()
+{
+  if (!benchSelected("drawString"))
+    return;
+  for (byte f = 0; f < BENCH_COUNT(benchFonts); f++)
+  {
+    if (benchFonts[f].data == ArabicFont)
+      continue;
+    DMD *dmd = benchDisplay(1);
+    dmd->selectFont(benchFonts[f].data);
+    for (byte m = 0; m < BENCH_COUNT(benchModes); m++)
+    {
+      byte mode = benchModes[m].mode;
+      dmd->clearScreen(true);
+      benchCase("drawString", benchFonts[f].name, benchModes[m].name, 1, [=](uint32_t i)
+                { dmd->drawString(-(int)(i & 31), 0, latinText, sizeof(latinText) - 1, mode); });
+    }
+  }
+}
+
+// Width of text a charWidthOfFont call per letter, reading the font header from flash
+static int perCharMeasureString(const uint8_t *font, const char *text, unsigned int length)
+{
+  int width = 0;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    int wide = charWidthOfFont(text[i], font);
+    if (wide > 0)
+      width += wide + 1;
+  }
+  return (width > 0) ? width - 1 : 0;
+}
+
+static volatile int measured;
+
+static void benchMeasure()
+{
+  for (byte f = 0; f < BENCH_COUNT(benchFonts); f++)
+  {
+    const uint8_t *font = benchFonts[f].data;
+    DMD *dmd = benchDisplay(1);
+    dmd->selectFont(font);
+    if (benchSelected("measureString"))
+      benchCase("measureString", benchFonts[f].name, NULL, 1, [=](uint32_t)
+                { measured = dmd->measureString(latinText, sizeof(latinText) - 1); });
+    if (benchSelected("measureStringPerChar"))
+      benchCase("measureStringPerChar", benchFonts[f].name, NULL, 1, [=](uint32_t)
+                { measured = perCharMeasureString(font, latinText, sizeof(latinText) - 1); });
+  }
+  if (benchSelected("measureArabic"))
+  {
+    DMD *dmd = benchDisplay(1);
+    dmd->selectFont(ArabicFont);
+    benchCase("measureArabic", "ArabicFont", NULL, 1, [=](uint32_t)
+              { measured = dmd->measureArabic(arabicText); });
+  }
+}
+
+static void benchArabic()
+{
+  DMD *dmd = benchDisplay(1);
+  dmd->selectFont(ArabicFont);
+  if (benchSelected("utf8ToArabic"))
+  {
+    static char glyphs[128];
+    benchCase("utf8ToArabic", "ArabicFont", NULL, 1, [=](uint32_t)
+              { dmd->utf8ToArabic(arabicText, glyphs, sizeof(glyphs)); });
+  }
+  if (benchSelected("utf8ToArabicHeadline"))
+  {
+    // a headline of about 200 characters, the text repeated
+    static char headline[10 * sizeof(arabicText)];
+    static char glyphs[256];
+    headline[0] = '\0';
+    for (byte n = 0; n < 10; n++)
+    {
+      strcat(headline, arabicText);
+      strcat(headline, " ");
+    }
+    benchCase("utf8ToArabicHeadline", "ArabicFont", NULL, 1, [=](uint32_t)
+              { dmd->utf8ToArabic(headline, glyphs, sizeof(glyphs)); });
+  }
+  if (benchSelected("utf8ToArabicAscii"))
+  {
+    // Latin text, copied without decoding or shaping
+    static char glyphs[128];
+    benchCase("utf8ToArabicAscii", "ArabicFont", NULL, 1, [=](uint32_t)
+              { dmd->utf8ToArabic(latinText, glyphs, sizeof(glyphs)); });
+  }
+  if (benchSelected("drawArabicString"))
+  {
+    for (byte m = 0; m < BENCH_COUNT(benchModes); m++)
+    {
+      byte mode = benchModes[m].mode;
+      dmd->clearScreen(true);
+      benchCase("drawArabicString", "ArabicFont", benchModes[m].name, 1, [=](uint32_t i)
+                { dmd->drawArabicString(-(int)(i & 31), 0, arabicText, mode); });
+    }
+  }
+  if (benchSelected("drawArabicStringCached"))
+  {
+    // the same text shaped once, every draw a cache hit
+    DMDShapeCache cache(4);
+    dmd->setShapeCache(&cache);
+    dmd->clearScreen(true);
+    benchCase("drawArabicStringCached", "ArabicFont", "NORMAL", 1, [=](uint32_t i)
+              { dmd->drawArabicString(-(int)(i & 31), 0, arabicText, GRAPHICS_NORMAL); });
+    dmd->setShapeCache(NULL);
+  }
+}
+
+static void benchStepMarquee()
+{
+  for (byte g = 0; g < BENCH_COUNT(benchGrids); g++)
+  {
+    DMD *dmd = benchDisplay(g);
+    dmd->selectFont(Arial_Black_16);
+    if (benchSelected("stepMarquee"))
+    {
+      // one and two pixel steps left
+      dmd->clearScreen(true);
+      dmd->drawMarquee(latinText, sizeof(latinText) - 1, dmd->getWidth() - 1, 0);
+      benchCase("stepMarquee", "Arial_Black_16", "left1", g, [=](uint32_t)
+                { dmd->stepMarquee(-1, 0); });
+      dmd->clearScreen(true);
+      dmd->drawMarquee(latinText, sizeof(latinText) - 1, dmd->getWidth() - 1, 0);
+      benchCase("stepMarquee", "Arial_Black_16", "left2", g, [=](uint32_t)
+                { dmd->stepMarquee(-2, 0); });
+      dmd->enableMarqueeStrip(true);
+      dmd->clearScreen(true);
+      dmd->drawMarquee(latinText, sizeof(latinText) - 1, dmd->getWidth() - 1, 0);
+      benchCase("stepMarquee", "Arial_Black_16", "strip", g, [=](uint32_t)
+                { dmd->stepMarquee(-1, 0); });
+      dmd->enableMarqueeStrip(false);
+    }
+    if (benchSelected("stepMarqueeArabic"))
+    {
+      dmd->selectFont(ArabicFont);
+      dmd->clearScreen(true);
+      dmd->drawArabicMarquee(arabicText, dmd->getWidth() - 1, 0);
+      benchCase("stepMarqueeArabic", "ArabicFont", "left1", g, [=](uint32_t)
+                { dmd->stepMarquee(-1, 0); });
+    }
+  }
+}
+
+static void benchContainer()
+{
+  for (byte g = 0; g < BENCH_COUNT(benchGrids); g++)
+  {
+    DMD *dmd = benchDisplay(g);
+    if (benchContainers[g] == NULL)
+    {
+      benchContainers[g] = new DMDContainer(0, 0, dmd->getWidth(), dmd->getHeight());
+      benchContainers[g]->setFont(System5x7);
+    }
+    DMDContainer *c = benchContainers[g];
+    c->clear();
+    c->appendText(0, 0, latinText, sizeof(latinText) - 1);
+    if (benchSelected("drawContainer"))
+    {
+      benchCase("drawContainer", NULL, NULL, g, [=](uint32_t)
+                { dmd->drawContainer(c); });
+    }
+    if (benchSelected("appendText"))
+    {
+      benchCase("appendText", "SystemFont5x7", NULL, g, [=](uint32_t i)
+                { c->appendText(-(int)(i & 31), 0, latinText, sizeof(latinText) - 1); });
+    }
+  }
+}
+
+// The per bit loop DMDContainer::appendChar used before it unpacked whole font bytes, kept
+// to compare against: one shift and mask per glyph bit, one bounds checked write per pixel
+static void perBitPixel(DMDContainer *c, int16_t x, int16_t y, uint8_t lit)
+{
+  if (x < 0 || y < 0 || x >= c->getCanvasW() || y >= c->getCanvasH())
+    return;
+  uint8_t *p = c->getBufferData() + y * c->getStride() + (x >> 3);
+  uint8_t mask = 0x80 >> (x & 7);
+  if (lit)
+    *p &= ~mask;
+  else
+    *p |= mask;
+}
+
+static uint8_t perBitAppendChar(DMDContainer *c, DMDFont &font, int16_t x, int16_t y, uint8_t letter)
+{
+  uint8_t height = font.getHeight();
+  uint8_t bytes = font.getBytesPerColumn();
+  const uint8_t *glyph = font.getGlyph(letter);
+  if (glyph == NULL)
+    return 0;
+  uint8_t width = font.getWidth(letter);
+  for (uint8_t j = 0; j < width; j++)
+  {
+    for (uint8_t i = bytes - 1; i < 254; i--)
+    {
+      uint8_t data = pgm_read_byte(glyph + j + (i * width));
+      int offset = (i * 8);
+      if ((i == bytes - 1) && bytes > 1)
+        offset = height - 8;
+      for (uint8_t k = 0; k < 8; k++)
+      {
+        if ((offset + k >= i * 8) && (offset + k <= height))
+          perBitPixel(c, j + x, k + y + offset, (data & (1 << k)) >> k);
+      }
+    }
+  }
+  return width;
+}
+
+static void benchAppendChar()
+{
+  if (!benchSelected("appendChar"))
+    return;
+  // a canvas tall enough for every font, glyphs drawn at every bit offset of a byte
+  DMDContainer *c = new DMDContainer(0, 0, 64, 40);
+  DMDFont *font = new DMDFont();
+  for (byte f = 0; f < BENCH_COUNT(benchFonts); f++)
+  {
+    c->setFont(benchFonts[f].data);
+    font->attach(benchFonts[f].data);
+    byte first = pgm_read_byte(benchFonts[f].data + FONT_FIRST_CHAR);
+    byte count = pgm_read_byte(benchFonts[f].data + FONT_CHAR_COUNT);
+    c->clear();
+    benchCase("appendChar", benchFonts[f].name, NULL, 1, [=](uint32_t i)
+              { c->appendChar((i * 5) % 24, 0, first + (i % count)); });
+    c->clear();
+    benchCase("appendCharPerBit", benchFonts[f].name, NULL, 1, [=](uint32_t i)
+              { perBitAppendChar(c, *font, (i * 5) % 24, 0, first + (i % count)); });
+  }
+  delete font;
+  delete c;
+}
+
+void dmdBenchRun(const DMDBenchPlatform &platform, uint32_t minTimeMs, const char *filter)
+{
+  bench = &platform;
+  benchMinNs = (uint64_t)minTimeMs * 1000000ULL;
+  benchFilter = filter;
+  benchFirst = true;
+
+  char head[96];
+  snprintf(head, sizeof(head), "{\"platform\":\"%s\",\"bits_per_pixel\":%d,\"results\":[",
+           platform.name, DMD_BITSPERPIXEL);
+  platform.write(head);
+
+  benchWritePixel();
+  benchDrawChar();
+  benchDrawString();
+  benchMeasure();
+  benchArabic();
+  benchStepMarquee();
+  benchContainer();
+  benchAppendChar();
+
+  platform.write("\n]}\n");
+}
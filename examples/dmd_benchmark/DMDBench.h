@@ -0,0 +1,27 @@
+#ifndef DMD_BENCH_H
+#define DMD_BENCH_H
+
+#include <stdint.h>
+
+// Benchmarks of the drawing hot paths, shared by the dmd_benchmark sketch and the host build
+// (extras/host/dmd_bench.cpp). Results are written as one JSON document:
+//
+//   {"platform":"esp32","bits_per_pixel":1,"results":[
+//    {"name":"drawChar","font":"Arial_14","mode":"NORMAL","grid":"2x1","ops":4096,
+//     "ns_per_op":812.5,"cycles_per_op":195.0}, ...]}
+//
+// Every case repeats its operation until minTimeMs has passed, timed with the platform clocks
+struct DMDBenchPlatform
+{
+  const char *name;
+  // Monotonic time in ns, and a cycle counter (NULL if there is none)
+  uint64_t (*nowNs)();
+  uint64_t (*nowCycles)();
+  // Write part of the JSON document
+  void (*write)(const char *text);
+};
+
+// Run every case whose name contains filter (NULL for all)
+void dmdBenchRun(const DMDBenchPlatform &platform, uint32_t minTimeMs, const char *filter);
+
+#endif
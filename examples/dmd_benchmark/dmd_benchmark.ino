@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------------------------
+ dmd_benchmark
+
+ Times the drawing hot paths of the library (writePixel, drawChar, drawString, Arabic text,
+ stepMarquee and drawContainer) for every font, graphics mode and panel grids from 1x1 to 8x4,
+ using the CPU cycle counter. Results are printed on Serial as one JSON document, see DMDBench.h.
+
+ The same benchmarks build on a workstation as dmd_bench, see extras/host/README.md.
+ No panels need to be connected, the display is not scanned while the benchmarks run.
+--------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Includes
+--------------------------------------------------------------------------------------*/
+#include <DMD32Plus.h>
+#include <esp_timer.h>
+#include "DMDBench.h"
+
+// Time spent on every benchmark case
+#define BENCH_MIN_TIME_MS 200
+
+static uint64_t benchNowNs()
+{
+  return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+// ESP.getCycleCount wraps every few seconds, extend it to 64 bits
+static uint64_t benchNowCycles()
+{
+  static uint32_t last;
+  static uint64_t high;
+  uint32_t now = ESP.getCycleCount();
+  if (now < last)
+    high += 1ULL << 32;
+  last = now;
+  return high | now;
+}
+
+static void benchWrite(const char *text)
+{
+  Serial.print(text);
+}
+
+/*--------------------------------------------------------------------------------------
+  setup
+  Called by the Arduino architecture before the main loop begins
+--------------------------------------------------------------------------------------*/
+void setup(void)
+{
+  Serial.begin(115200);
+  delay(1000);
+
+  DMDBenchPlatform platform = {"esp32", benchNowNs, benchNowCycles, benchWrite};
+  dmdBenchRun(platform, BENCH_MIN_TIME_MS, NULL);
+}
+
+/*--------------------------------------------------------------------------------------
+  loop
+  Arduino architecture main loop
+--------------------------------------------------------------------------------------*/
+void loop(void)
+{
+}
@@ -37,19 +37,6 @@
 // Fire up the DMD library as dmd
 DMD dmd(1, 1);
 
-// Timer setup
-// create a hardware timer  of ESP32
-hw_timer_t *timer = NULL;
-
-/*--------------------------------------------------------------------------------------
-  Interrupt handler for Timer1 (TimerOne) driven DMD refresh scanning, this gets
-  called at the period set in Timer1.initialize();
---------------------------------------------------------------------------------------*/
-void IRAM_ATTR triggerScan()
-{
-  dmd.scanDisplayBySPI();
-}
-
 /*--------------------------------------------------------------------------------------
   Show clock numerals on the screen from a 4 digit time value, and select whether the
   flashing colon is on or off
@@ -73,9 +60,8 @@ void ShowClockNumbers(unsigned int uiTime, byte bColonOn)
 --------------------------------------------------------------------------------------*/
 void setup(void)
 {
-  timer = timerBegin(1000000L); // 1Mhz
-  timerAttachInterrupt(timer, &triggerScan);
-  timerAlarm(timer, 1000, true, 0); // alarm every 1ms
+  // scan the display from a hardware timer, 250 full refreshes per second (a scan line every 1ms)
+  dmd.beginScanning(250);
 
   // clear/init the DMD pixels held in RAM
   dmd.clearScreen(true); // true is normal (all pixels off), false is negative (all pixels on)
@@ -47,28 +47,14 @@ characters as part of the hexadecimal sequence.
 #define DISPLAYS_DOWN 1
 DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN);
 
-// Timer setup
-// create a hardware timer  of ESP32
-hw_timer_t *timer = NULL;
-
-/*--------------------------------------------------------------------------------------
-  Interrupt handler for Timer1 (TimerOne) driven DMD refresh scanning, this gets
-  called at the period set in Timer1.initialize();
---------------------------------------------------------------------------------------*/
-void IRAM_ATTR triggerScan()
-{
-  dmd.scanDisplayBySPI();
-}
-
 /*--------------------------------------------------------------------------------------
   setup
   Called by the Arduino architecture before the main loop begins
 --------------------------------------------------------------------------------------*/
 void setup(void)
 {
-  timer = timerBegin(1000000L); // 1Mhz
-  timerAttachInterrupt(timer, &triggerScan);
-  timerAlarm(timer, 1000, true, 0); // alarm every 1ms
+  // scan the display from a hardware timer, 250 full refreshes per second (a scan line every 1ms)
+  dmd.beginScanning(250);
 
   // clear/init the DMD pixels held in RAM
   dmd.clearScreen(true); // true is normal (all pixels off), false is negative (all pixels on)
@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------------------------
+This example scrolls two marquees at their own pace in separate areas of the display:
+a ticker along the bottom half and a slower one in the top right corner, while the
+clock text in the top left corner stays where it is.
+
+Each DMDMarquee only shifts and draws the pixels of its own rectangle, and the
+DMDMarqueeScheduler moves all of them at their own speed in pixels per second, so the
+scrolling stays smooth when the loop is held up (by WiFi for instance).
+--------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Includes
+--------------------------------------------------------------------------------------*/
+#include <DMD32Plus.h>
+#include <DMDMarquee.h>
+#include "fonts/SystemFont5x7.h"
+
+// Fire up the DMD library as dmd
+#define DISPLAYS_ACROSS 2
+#define DISPLAYS_DOWN 1
+DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN);
+
+// Bottom half, and the top right corner of the display
+DMDMarquee ticker(&dmd, 0, 8, 63, 15);
+DMDMarquee corner(&dmd, 32, 0, 63, 7);
+DMDMarqueeScheduler scheduler;
+
+const char tickerText[] = "Welcome To Indonesia";
+const char cornerText[] = "24 C";
+
+/*--------------------------------------------------------------------------------------
+  setup
+  Called by the Arduino architecture before the main loop begins
+--------------------------------------------------------------------------------------*/
+void setup(void) {
+  // Scan the display from a hardware timer, 250 full refreshes per second
+  dmd.beginScanning(250);
+  dmd.clearScreen(true);
+
+  // Static text, outside both marquees
+  dmd.selectFont(SystemFont5x7);
+  dmd.drawString(0, 0, "12:00", 5, GRAPHICS_NORMAL);
+
+  // Ticker, 40 pixels a second to the left, entering from the right edge of its area
+  ticker.selectFont(SystemFont5x7);
+  ticker.setSpeed(DMD_SPEED(-40), 0);
+  ticker.drawText(tickerText, strlen(tickerText), 64, 0);
+
+  // Corner, 7.5 pixels a second
+  corner.selectFont(SystemFont5x7);
+  corner.setSpeed(DMD_SPEED(-7.5), 0);
+  corner.drawText(cornerText, strlen(cornerText), 32, 0);
+
+  scheduler.add(&ticker);
+  scheduler.add(&corner);
+}
+
+/*--------------------------------------------------------------------------------------
+  loop
+  Arduino architecture main loop
+--------------------------------------------------------------------------------------*/
+void loop(void) {
+  scheduler.update(micros());
+}
@@ -9,6 +9,9 @@ DMDContainer is designed to manage pixel-level rendering within a specified regi
 the display. By leveraging this class, you can effectively partition a P10 LED matrix 
 into multiple independent display zones, each capable of rendering text or graphics 
 separately. 
+
+The text is drawn once into a canvas wider than the container, and scrolling only moves the
+container's window over that canvas.
 --------------------------------------------------------------------------------------*/
 
 /*--------------------------------------------------------------------------------------
@@ -24,29 +27,20 @@ separately.
 #define DISPLAYS_DOWN 1
 DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN);
 
-// A container to draw the running text
-DMDContainer container(0, 0, 11, 16);
+// A 32x16 window over a 256x16 canvas holding the running text
+DMDContainer container(0, 0, 32, 16, 256, 16);
+
+// Width of the text drawn in the canvas
+uint16_t textWidth;
 
-// Horizontal position (x) of the running text
-int16_t posX;
+// Canvas column shown at the left of the window
+int16_t scrollX;
 
 // Last update time of the running text position 
 long last;
 
 char scrollingText[] = "Welcome To Indonesia";
 
-// Timer setup
-// create a hardware timer  of ESP32
-hw_timer_t *timer = NULL;
-
-/*--------------------------------------------------------------------------------------
-  Interrupt handler for timer driven DMD refresh scanning, this gets
-  called at the period set in timerAlarm;
---------------------------------------------------------------------------------------*/
-void IRAM_ATTR triggerScan() {
-  dmd.scanDisplayBySPI();
-}
-
 /*--------------------------------------------------------------------------------------
   setup
   Called by the Arduino architecture before the main loop begins
@@ -54,14 +48,8 @@ void IRAM_ATTR triggerScan() {
 void setup(void) {
   Serial.begin(115200);
 
-  // Create timer with 1MHz frequency
-  timer = timerBegin(1000000L);  // 1MHz
-
-  // Attach interrupt to the timer
-  timerAttachInterrupt(timer, &triggerScan);
-
-  // Set alarm to the timer every 1000 ticks (1ms), then repeat 
-  timerAlarm(timer, 1000, true, 0);
+  // Scan the display from a hardware timer, 250 full refreshes per second (a scan line every 1ms)
+  dmd.beginScanning(250);
 
   // clear/init the DMD pixels held in RAM
   dmd.clearScreen(true);  // true is normal (all pixels off), false is negative (all pixels on)
@@ -69,8 +57,11 @@ void setup(void) {
   // Set font for the container
   container.setFont(Arial_Black_16);
 
-  // Set initial horizontal position of the running text
-  posX = container.getX1();
+  // Draw the text into the canvas once
+  textWidth = container.appendText(0, 0, scrollingText, strlen(scrollingText));
+
+  // Start with the text just right of the window
+  scrollX = -container.getW();
 }
 
 /*--------------------------------------------------------------------------------------
@@ -82,22 +73,18 @@ void loop(void) {
   if (millis() - last > 50) {
     last = millis();
 
-    // Clear pixel in the container
-    container.clear();
-
-    // Append text to the container
-    // Get the width to check if the running text is completely out of the container area
-    uint16_t w = container.appendText(posX, 0, scrollingText, strlen(scrollingText));
+    // Show the canvas from scrollX, columns left of the canvas are unlit
+    container.setScroll(scrollX, 0);
 
     // Draw the container to DMD 
     dmd.drawContainer(&container);
 
-    // Move horizontal position left
-    posX--;
+    // Move the window right, so the text runs left
+    scrollX++;
 
-    if (posX + w == 0) {
-      // Reset horizontal position when running text is out of the container area
-      posX = container.getX1();
+    if (scrollX == textWidth) {
+      // Start again once the text has left the window
+      scrollX = -container.getW();
     }
   }
 }
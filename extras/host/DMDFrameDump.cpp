@@ -0,0 +1,53 @@
+#include "DMDFrameDump.h"
+
+std::string dmdFrameAscii(DMD &dmd)
+{
+    std::string frame;
+    frame.reserve((dmd.getWidth() + 1) * dmd.getHeight());
+    for (int y = 0; y < dmd.getHeight(); y++)
+    {
+        for (int x = 0; x < dmd.getWidth(); x++)
+        {
+            byte level = dmd.readPixelLevel(x, y);
+            if (level == 0)
+                frame += '.';
+            else if (level == DMD_MAX_INTENSITY)
+                frame += '#';
+            else
+                frame += (char)('0' + level);
+        }
+        frame += '\n';
+    }
+    return frame;
+}
+
+void dmdWritePbm(DMD &dmd, FILE *out)
+{
+    if (DMD_MAX_INTENSITY == 1)
+        fprintf(out, "P1\n%d %d\n", dmd.getWidth(), dmd.getHeight());
+    else
+        fprintf(out, "P2\n%d %d\n%d\n", dmd.getWidth(), dmd.getHeight(), DMD_MAX_INTENSITY);
+
+    for (int y = 0; y < dmd.getHeight(); y++)
+    {
+        for (int x = 0; x < dmd.getWidth(); x++)
+        {
+            byte level = dmd.readPixelLevel(x, y);
+            // PBM 1 is black, PGM 0 is black
+            if (DMD_MAX_INTENSITY == 1)
+                fprintf(out, x ? " %d" : "%d", level);
+            else
+                fprintf(out, x ? " %d" : "%d", DMD_MAX_INTENSITY - level);
+        }
+        fputc('\n', out);
+    }
+}
+
+bool dmdSavePbm(DMD &dmd, const char *path)
+{
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+        return false;
+    dmdWritePbm(dmd, out);
+    return fclose(out) == 0;
+}
@@ -0,0 +1,16 @@
+#ifndef DMD_FRAME_DUMP_H
+#define DMD_FRAME_DUMP_H
+
+#include <stdio.h>
+#include <string>
+#include "DMD32Plus.h"
+
+// Frames of DMD RAM for headless tests. ASCII frames are one line per pixel row, '.' for an
+// unlit pixel and '#' for a fully lit one (intensity levels in between as digits)
+std::string dmdFrameAscii(DMD &dmd);
+
+// Write DMD RAM as a plain PBM image (plain PGM when DMD_BITSPERPIXEL > 1), lit pixels are black
+void dmdWritePbm(DMD &dmd, FILE *out);
+bool dmdSavePbm(DMD &dmd, const char *path);
+
+#endif
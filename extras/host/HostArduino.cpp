@@ -0,0 +1,230 @@
+#include "Arduino.h"
+#include "SPI.h"
+#include "esp_rom_gpio.h"
+#include "esp32-hal-periman.h"
+#include "soc/gpio_sig_map.h"
+#include <chrono>
+#include <thread>
+
+HostPins hostPins;
+HostSpiLog hostSpiLog;
+
+struct timer_struct_t
+{
+    uint32_t frequency;
+    void (*callback)(void *);
+    void *arg;
+    uint64_t alarm;
+    bool armed;
+};
+
+static hw_timer_t *lastTimer = NULL;
+static uint8_t ledcChannels = 0;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+/*--------------------------------------------------------------------------------------
+ Pins
+--------------------------------------------------------------------------------------*/
+void hostPinsReset()
+{
+    memset(&hostPins, 0, sizeof(hostPins));
+    ledcChannels = 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin >= HOST_PIN_COUNT)
+        return;
+    hostPins.mode[pin] = mode;
+    // an output is driven by its GPIO level again, as gpio_config routes it
+    if (mode == OUTPUT)
+        hostPins.outSignal[pin] = SIG_GPIO_OUT_IDX;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < HOST_PIN_COUNT)
+    {
+        hostPins.level[pin] = val ? HIGH : LOW;
+        hostPins.writes[pin]++;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    // inputs float high, like the pulled up nCS pin the scan checks
+    if (pin >= HOST_PIN_COUNT)
+        return HIGH;
+    return (hostPins.mode[pin] == OUTPUT) ? hostPins.level[pin] : HIGH;
+}
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution)
+{
+    if (pin >= HOST_PIN_COUNT || freq == 0 || resolution == 0 || resolution > 20)
+        return false;
+    hostPins.ledcAttached[pin] = true;
+    hostPins.ledcDuty[pin] = 0;
+    hostPins.ledc[pin].pin = pin;
+    hostPins.ledc[pin].channel = ledcChannels++;
+    hostPins.ledc[pin].channel_resolution = resolution;
+    // the channel is routed to the pin, as the core does on attach
+    uint8_t channel = hostPins.ledc[pin].channel;
+    hostPins.outSignal[pin] = (channel < 8 ? LEDC_HS_SIG_OUT0_IDX : LEDC_LS_SIG_OUT0_IDX) + channel % 8;
+    return true;
+}
+
+bool ledcWrite(uint8_t pin, uint32_t duty)
+{
+    if (pin >= HOST_PIN_COUNT || !hostPins.ledcAttached[pin])
+        return false;
+    hostPins.ledcDuty[pin] = duty;
+    hostPins.writes[pin]++;
+    return true;
+}
+
+bool ledcDetach(uint8_t pin)
+{
+    if (pin >= HOST_PIN_COUNT || !hostPins.ledcAttached[pin])
+        return false;
+    hostPins.ledcAttached[pin] = false;
+    return true;
+}
+
+void *perimanGetPinBus(uint8_t pin, peripheral_bus_type_t type)
+{
+    if (type != ESP32_BUS_TYPE_LEDC || pin >= HOST_PIN_COUNT || !hostPins.ledcAttached[pin])
+        return NULL;
+    return &hostPins.ledc[pin];
+}
+
+void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool /* out_inv */, bool /* oen_inv */)
+{
+    if (gpio_num >= HOST_PIN_COUNT)
+        return;
+    hostPins.outSignal[gpio_num] = signal_idx;
+    hostPins.routes[gpio_num]++;
+}
+
+/*--------------------------------------------------------------------------------------
+ Time
+--------------------------------------------------------------------------------------*/
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+/*--------------------------------------------------------------------------------------
+ Timers
+--------------------------------------------------------------------------------------*/
+hw_timer_t *timerBegin(uint32_t frequency)
+{
+    hw_timer_t *timer = (hw_timer_t *)calloc(1, sizeof(hw_timer_t));
+    if (timer)
+        timer->frequency = frequency;
+    lastTimer = timer;
+    return timer;
+}
+
+void timerEnd(hw_timer_t *timer)
+{
+    if (timer == lastTimer)
+        lastTimer = NULL;
+    free(timer);
+}
+
+void timerAttachInterruptArg(hw_timer_t *timer, void (*userFunc)(void *), void *arg)
+{
+    timer->callback = userFunc;
+    timer->arg = arg;
+}
+
+void timerAlarm(hw_timer_t *timer, uint64_t alarm_value, bool /* autoreload */, uint64_t /* reload_count */)
+{
+    timer->alarm = alarm_value;
+    timer->armed = true;
+}
+
+bool hostTimerFire(hw_timer_t *timer)
+{
+    if (timer == NULL || !timer->armed || timer->callback == NULL)
+        return false;
+    timer->callback(timer->arg);
+    return true;
+}
+
+hw_timer_t *hostLastTimer()
+{
+    return lastTimer;
+}
+
+uint64_t hostTimerAlarmUs(hw_timer_t *timer)
+{
+    if (timer == NULL || timer->frequency == 0)
+        return 0;
+    return timer->alarm * 1000000ULL / timer->frequency;
+}
+
+/*--------------------------------------------------------------------------------------
+ SPI
+--------------------------------------------------------------------------------------*/
+void hostSpiReset()
+{
+    hostSpiLog.transactions = 0;
+    hostSpiLog.bytes.clear();
+    hostSpiLog.transactionStarts.clear();
+}
+
+bool SPIClass::begin(int8_t /* sck */, int8_t /* miso */, int8_t /* mosi */, int8_t /* ss */)
+{
+    return true;
+}
+
+void SPIClass::end()
+{
+}
+
+void SPIClass::beginTransaction(SPISettings /* settings */)
+{
+    hostSpiLog.transactions++;
+    hostSpiLog.transactionStarts.push_back(hostSpiLog.bytes.size());
+}
+
+void SPIClass::endTransaction()
+{
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    hostSpiLog.bytes.push_back(data);
+    return 0;
+}
+
+void SPIClass::writeBytes(const uint8_t *data, uint32_t size)
+{
+    hostSpiLog.bytes.insert(hostSpiLog.bytes.end(), data, data + size);
+}
+
+void SPIClass::transferBytes(const uint8_t *data, uint8_t *out, uint32_t size)
+{
+    hostSpiLog.bytes.insert(hostSpiLog.bytes.end(), data, data + size);
+    if (out)
+        memset(out, 0, size);
+}
@@ -0,0 +1,38 @@
+#include "HostFonts.h"
+#include <string.h>
+#include "Arduino.h"
+#include "fonts/SystemFont5x7.h"
+#include "fonts/Arial14.h"
+#include "fonts/Arial_38b.h"
+#include "fonts/Arial_Black21.h"
+#include "fonts/Arial_Black_16_ISO_8859_1.h"
+#include "fonts/Arial_black_16.h"
+#include "fonts/BodoniMTBlack24.h"
+#include "fonts/Comic24.h"
+#include "fonts/Droid_Sans_24.h"
+#include "fonts/ArabicFont.h"
+
+const HostFont hostFonts[] = {
+    {"SystemFont5x7", System5x7},
+    {"Arial_14", Arial_14},
+    {"Arial_38b", Arial_38b},
+    {"Arial_Black21", Arial_Black21},
+    {"Arial_Black_16_ISO_8859_1", Arial_Black_16_ISO_8859_1},
+    {"Arial_Black_16", Arial_Black_16},
+    {"BodoniMTBlack24", BodoniMTBlack24},
+    {"Comic24", Comic24},
+    {"Droid_Sans_24", Droid_Sans_24},
+    {"ArabicFont", ArabicFont},
+};
+
+const int hostFontCount = sizeof(hostFonts) / sizeof(hostFonts[0]);
+
+const uint8_t *hostFindFont(const char *name)
+{
+    for (int i = 0; i < hostFontCount; i++)
+    {
+        if (strcmp(hostFonts[i].name, name) == 0)
+            return hostFonts[i].data;
+    }
+    return NULL;
+}
@@ -0,0 +1,19 @@
+#ifndef HOST_FONTS_H
+#define HOST_FONTS_H
+
+#include <stdint.h>
+
+// The fonts in fonts/ DMD::selectFont can draw, by name (Tahoma_32 uses another format)
+struct HostFont
+{
+    const char *name;
+    const uint8_t *data;
+};
+
+extern const HostFont hostFonts[];
+extern const int hostFontCount;
+
+// Look up a font by name, NULL if there is none
+const uint8_t *hostFindFont(const char *name);
+
+#endif
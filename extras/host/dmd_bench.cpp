@@ -0,0 +1,72 @@
+// Run the benchmarks of examples/dmd_benchmark on the host and print the JSON results.
+//
+//   dmd_bench [-t ms] [-o results.json] [filter]
+//
+// -t is the time spent on every case (default 100), filter runs only the cases whose name
+// contains it. Cycles are counted with the x86 time stamp counter where there is one
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "DMDBench.h"
+
+static FILE *out = stdout;
+
+static uint64_t hostNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint64_t hostNowCycles()
+{
+    return __rdtsc();
+}
+#endif
+
+static void hostWrite(const char *text)
+{
+    fputs(text, out);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t minTimeMs = 100;
+    const char *outPath = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            minTimeMs = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: dmd_bench [-t ms] [-o results.json] [filter]\n");
+            return 2;
+        }
+    }
+    if (outPath && (out = fopen(outPath, "w")) == NULL)
+    {
+        perror(outPath);
+        return 1;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    DMDBenchPlatform platform = {"host", hostNowNs, hostNowCycles, hostWrite};
+#else
+    DMDBenchPlatform platform = {"host", hostNowNs, NULL, hostWrite};
+#endif
+    dmdBenchRun(platform, minTimeMs, optind < argc ? argv[optind] : NULL);
+    return fclose(out) == 0 ? 0 : 1;
+}
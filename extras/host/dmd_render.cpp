@@ -0,0 +1,85 @@
+// Render text with the library on the host and print the frame.
+//
+//   dmd_render [-p WIDExHIGH] [-f font] [-a] [-s steps] [-o out.pbm] text
+//
+// -a draws the text as UTF-8 Arabic, -s scrolls it as a marquee for that many steps first,
+// -o writes a PBM image instead of printing ASCII
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "DMD32Plus.h"
+#include "DMDFrameDump.h"
+#include "HostFonts.h"
+
+static int usage()
+{
+    fprintf(stderr, "usage: dmd_render [-p WIDExHIGH] [-f font] [-a] [-s steps] [-o out.pbm] text\nfonts:");
+    for (int i = 0; i < hostFontCount; i++)
+        fprintf(stderr, " %s", hostFonts[i].name);
+    fputc('\n', stderr);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    int wide = 1, high = 1, steps = 0;
+    bool arabic = false;
+    const char *fontName = "SystemFont5x7";
+    const char *outPath = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:f:as:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            if (sscanf(optarg, "%dx%d", &wide, &high) != 2 || wide < 1 || high < 1)
+                return usage();
+            break;
+        case 'f':
+            fontName = optarg;
+            break;
+        case 'a':
+            arabic = true;
+            break;
+        case 's':
+            steps = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            return usage();
+        }
+    }
+    if (optind != argc - 1)
+        return usage();
+
+    const uint8_t *font = hostFindFont(arabic && strcmp(fontName, "SystemFont5x7") == 0 ? "ArabicFont" : fontName);
+    if (font == NULL)
+        return usage();
+
+    const char *text = argv[optind];
+    DMD dmd(wide, high);
+    dmd.selectFont(font);
+    if (steps > 0)
+    {
+        if (arabic)
+            dmd.drawArabicMarquee(text, dmd.getWidth() - 1, 0);
+        else
+            dmd.drawMarquee(text, strlen(text), dmd.getWidth() - 1, 0);
+        for (int i = 0; i < steps; i++)
+            dmd.stepMarquee(-1, 0);
+    }
+    else if (arabic)
+        dmd.drawArabicString(0, 0, text, GRAPHICS_NORMAL);
+    else
+        dmd.drawString(0, 0, text, strlen(text), GRAPHICS_NORMAL);
+
+    if (outPath)
+        return dmdSavePbm(dmd, outPath) ? 0 : 1;
+    fputs(dmdFrameAscii(dmd).c_str(), stdout);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino core for building the library on a workstation (see extras/host/README.md).
+// Pins, LEDC and timers only record what the library does with them, the SPI bus is in SPI.h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define SS 5
+
+#define HOST_PIN_COUNT 64
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// LEDC, arduino-esp32 3.x API. Channels are given out in order, the first 8 are the high
+// speed ones on an ESP32
+typedef struct
+{
+    uint8_t pin;
+    uint8_t channel;
+    uint8_t channel_resolution;
+} ledc_channel_handle_t;
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool ledcWrite(uint8_t pin, uint32_t duty);
+bool ledcDetach(uint8_t pin);
+
+// Hardware timer, arduino-esp32 3.x API. Alarms never fire by themselves,
+// call hostTimerFire to run the attached interrupt
+typedef struct timer_struct_t hw_timer_t;
+hw_timer_t *timerBegin(uint32_t frequency);
+void timerEnd(hw_timer_t *timer);
+void timerAttachInterruptArg(hw_timer_t *timer, void (*userFunc)(void *), void *arg);
+void timerAlarm(hw_timer_t *timer, uint64_t alarm_value, bool autoreload, uint64_t reload_count);
+
+// What the library did to the pins, for tests
+struct HostPins
+{
+    uint8_t mode[HOST_PIN_COUNT];
+    uint8_t level[HOST_PIN_COUNT];
+    uint32_t writes[HOST_PIN_COUNT];
+    bool ledcAttached[HOST_PIN_COUNT];
+    uint32_t ledcDuty[HOST_PIN_COUNT];
+    ledc_channel_handle_t ledc[HOST_PIN_COUNT];
+    // GPIO matrix output signal of each pin, and how often it was routed
+    uint32_t outSignal[HOST_PIN_COUNT];
+    uint32_t routes[HOST_PIN_COUNT];
+};
+extern HostPins hostPins;
+void hostPinsReset();
+
+// Run the interrupt of a timer with an alarm set, returns false if there is none
+bool hostTimerFire(hw_timer_t *timer);
+// The last timer begun, or NULL once it is ended
+hw_timer_t *hostLastTimer();
+uint64_t hostTimerAlarmUs(hw_timer_t *timer);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+// SPI bus that records every transaction and byte sent, see hostSpiLog
+
+#include "Arduino.h"
+#include <vector>
+
+#define VSPI 3
+#define HSPI 2
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define SPI_MODE0 0x00
+
+struct HostSpiLog
+{
+    uint32_t transactions;
+    std::vector<uint8_t> bytes;
+    // Offset into bytes at the start of every transaction
+    std::vector<size_t> transactionStarts;
+};
+extern HostSpiLog hostSpiLog;
+void hostSpiReset();
+
+class SPISettings
+{
+public:
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+        : _clock(clock), _bitOrder(bitOrder), _dataMode(dataMode) {}
+    uint32_t _clock;
+    uint8_t _bitOrder;
+    uint8_t _dataMode;
+};
+
+class SPIClass
+{
+public:
+    SPIClass(uint8_t spi_bus = HSPI) : _bus(spi_bus) {}
+    bool begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1);
+    void end();
+    void beginTransaction(SPISettings settings);
+    void endTransaction();
+    uint8_t transfer(uint8_t data);
+    void writeBytes(const uint8_t *data, uint32_t size);
+    void transferBytes(const uint8_t *data, uint8_t *out, uint32_t size);
+
+private:
+    uint8_t _bus;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_ESP32_HAL_PERIMAN_H
+#define HOST_ESP32_HAL_PERIMAN_H
+
+// Peripheral manager of arduino-esp32 3.x, only the LEDC bus of a pin is known
+
+#include <stdint.h>
+
+typedef enum
+{
+    ESP32_BUS_TYPE_INIT,
+    ESP32_BUS_TYPE_GPIO,
+    ESP32_BUS_TYPE_LEDC,
+} peripheral_bus_type_t;
+
+void *perimanGetPinBus(uint8_t pin, peripheral_bus_type_t type);
+
+#endif
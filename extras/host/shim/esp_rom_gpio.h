@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_ROM_GPIO_H
+#define HOST_ESP_ROM_GPIO_H
+
+// GPIO matrix routing of the ESP32 ROM, recorded in hostPins.outSignal
+
+#include <stdint.h>
+
+void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool out_inv, bool oen_inv);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_GPIO_SIG_MAP_H
+#define HOST_GPIO_SIG_MAP_H
+
+// GPIO matrix output signals, as numbered on the ESP32
+
+#define LEDC_HS_SIG_OUT0_IDX 71
+#define LEDC_LS_SIG_OUT0_IDX 79
+#define SIG_GPIO_OUT_IDX 256
+
+#endif
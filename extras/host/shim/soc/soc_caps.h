@@ -0,0 +1,8 @@
+#ifndef HOST_SOC_CAPS_H
+#define HOST_SOC_CAPS_H
+
+// The host stands in for an ESP32, which has high speed LEDC channels
+
+#define SOC_LEDC_SUPPORT_HS_MODE 1
+
+#endif
@@ -0,0 +1,1577 @@
+// Headless tests of the library against the host shim. Run with a test name to run only that test.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "DMD32Plus.h"
+#include "DMDMarquee.h"
+#include "DMDCompositor.h"
+#include "DMDBidi.h"
+#include "DMDUtf8.h"
+#include "utils.h"
+#include "SPI.h"
+#include "DMDFrameDump.h"
+#include "HostFonts.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                      \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+static std::string frameRows(DMD &dmd, int y0, int rows, int width)
+{
+    std::string frame = dmdFrameAscii(dmd), out;
+    int stride = dmd.getWidth() + 1;
+    for (int y = y0; y < y0 + rows; y++)
+        out += frame.substr(y * stride, width) + "\n";
+    return out;
+}
+
+static void testPixelReadBack()
+{
+    DMD dmd(2, 2);
+    CHECK(dmd.getWidth() == 64 && dmd.getHeight() == 32);
+    dmd.clearScreen(true);
+    const int pts[][2] = {{0, 0}, {31, 15}, {32, 0}, {63, 31}, {5, 17}, {40, 20}};
+    for (unsigned i = 0; i < sizeof(pts) / sizeof(pts[0]); i++)
+        dmd.writePixel(pts[i][0], pts[i][1], GRAPHICS_NORMAL, true);
+
+    int lit = 0;
+    for (int y = 0; y < 32; y++)
+        for (int x = 0; x < 64; x++)
+            lit += dmd.readPixelLevel(x, y) != 0;
+    CHECK(lit == 6);
+    for (unsigned i = 0; i < sizeof(pts) / sizeof(pts[0]); i++)
+        CHECK(dmd.readPixelLevel(pts[i][0], pts[i][1]) == DMD_MAX_INTENSITY);
+    CHECK(dmd.readPixelLevel(64, 0) == 0);
+}
+
+static void testGrayscale()
+{
+    // every level reads back as written, next to pixels of other levels
+    DMD dmd(2, 1);
+    dmd.clearScreen(true);
+    for (int x = 0; x < 64; x++)
+        dmd.writePixelLevel(x, x & 15, x % (DMD_MAX_INTENSITY + 1));
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 16; y++)
+            CHECK(dmd.readPixelLevel(x, y) == ((y == (x & 15)) ? x % (DMD_MAX_INTENSITY + 1) : 0));
+
+    // bit plane n of every scan line is on the bus for 2^n of the line's ticks, and a pixel
+    // of level 1 is only lit in plane 0
+    dmd.clearScreen(true);
+    dmd.writePixelLevel(0, 0, 1);
+    hostSpiReset();
+    std::vector<uint32_t> starts;
+    uint32_t calls = 4 * dmdLineTicks(DMD_BITSPERPIXEL);
+    for (uint32_t call = 0; call < calls; call++)
+    {
+        uint32_t before = hostSpiLog.transactions;
+        dmd.scanDisplayBySPI();
+        if (hostSpiLog.transactions != before)
+            starts.push_back(call);
+    }
+    CHECK(starts.size() == 4 * DMD_BITSPERPIXEL);
+    for (size_t t = 0; t < starts.size(); t++)
+    {
+        uint32_t ticks = ((t + 1 < starts.size()) ? starts[t + 1] : calls) - starts[t];
+        CHECK(ticks == dmdPlaneTicks(t % DMD_BITSPERPIXEL));
+        CHECK(hostSpiLog.bytes[t * 32 + 3] == ((t == 0) ? 0x7F : 0xFF));
+    }
+}
+
+static void testDrawString()
+{
+    DMD dmd(1, 1);
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.drawString(0, 0, "HI", 2, GRAPHICS_NORMAL);
+    CHECK(frameRows(dmd, 0, 8, 12) ==
+          "#...#..###..\n"
+          "#...#...#...\n"
+          "#...#...#...\n"
+          "#####...#...\n"
+          "#...#...#...\n"
+          "#...#...#...\n"
+          "#...#..###..\n"
+          "............\n");
+}
+
+static void checkMarqueeScroll(boolean strip)
+{
+    // every step leaves the same frame as drawing the text afresh where the marquee now is
+    const char *fonts[] = {"SystemFont5x7", "Arial_Black_16"};
+    const int steps[][2] = {{-1, 0}, {-3, 0}, {2, 0}, {1, 0}, {-33, 0}, {-7, 0}, {0, 1}, {-2, -1},
+                            {0, -3}, {5, 2}, {-40, 0}, {-1, 0}};
+    for (int f = 0; f < 2; f++)
+    {
+        DMD dmd(2, 1), fresh(2, 1);
+        dmd.enableMarqueeStrip(strip);
+        dmd.selectFont(hostFindFont(fonts[f]));
+        fresh.selectFont(hostFindFont(fonts[f]));
+        dmd.clearScreen(true);
+        dmd.drawMarquee("Hello World", 11, 20, 0);
+        int x = 20, y = 0;
+        for (int n = 0; n < 40; n++)
+        {
+            const int *step = steps[n % (sizeof(steps) / sizeof(steps[0]))];
+            if (dmd.stepMarquee(step[0], step[1]))
+                break;
+            x += step[0];
+            y += step[1];
+            fresh.clearScreen(true);
+            fresh.drawString(x, y, "Hello World", 11, GRAPHICS_NORMAL);
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+        }
+    }
+}
+
+static void testMarqueeScroll()
+{
+    checkMarqueeScroll(false);
+}
+
+static void testMarqueeStrip()
+{
+    checkMarqueeScroll(true);
+
+    // Arabic marquees are drawn compact, and the strip leaves the rows outside the marquee alone
+    const char *text = "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 abc";
+    DMD dmd(2, 2), fresh(2, 2);
+    dmd.enableMarqueeStrip(true);
+    dmd.selectFont(hostFindFont("ArabicFont"));
+    fresh.selectFont(hostFindFont("ArabicFont"));
+    dmd.clearScreen(true);
+    dmd.drawLine(0, 31, 63, 31, GRAPHICS_NORMAL);
+    dmd.drawArabicMarquee(text, 63, 2);
+    int x = 63, y = 2;
+    for (int n = 0; n < 30; n++)
+    {
+        int dy = (n % 3 == 0) ? 1 : 0;
+        dmd.stepMarquee(-3, dy);
+        x -= 3;
+        y += dy;
+        fresh.clearScreen(true);
+        fresh.drawLine(0, 31, 63, 31, GRAPHICS_NORMAL);
+        fresh.drawArabicString(x, y, text, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+}
+
+static void testArabicForms()
+{
+    // contextual forms, lam-alef ligatures, tatweel and digits, in logical order
+    struct
+    {
+        const char *utf8;
+        const char *glyphs;
+    } cases[] = {
+        {"\xd8\xa8\xd9\x83\xd9\x85", "\x8b\xd6\xdc"},         // beh kaf meem
+        {"\xd8\xa8 \xd8\xaf\xd8\xa8", "\x89 \xa3\x89"},        // beh, dal beh
+        {"\xd9\x84\xd8\xa7", "\xfe"},                       // lam alef
+        {"\xd8\xa8\xd9\x84\xd8\xa3\xd8\xa8", "\x8b\xff\x89"}, // beh lam-alef beh
+        {"\xd9\x80\xd8\xa8\xd9\x80", "\xef\x8c\xef"},         // tatweel beh tatweel
+        {"\xd9\xa1\xdb\xb2\xd8\x9f\xd8\x8c", "12\xfd\xfb"},     // digits ? ,
+        {"\xd8\xa1\xd9\x87\xd8\xa9x", "\x80\xe5\x8e" "x"},     // hamza heh teh marbuta
+    };
+    DMD dmd(1, 1);
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        char glyphs[32];
+        unsigned int length = dmd.utf8ToArabic(cases[i].utf8, glyphs, sizeof(glyphs));
+        CHECK(length == strlen(cases[i].glyphs) && strcmp(glyphs, cases[i].glyphs) == 0);
+    }
+}
+
+// Glyphs of utf8ToArabic in the visual order of a right to left line, as drawArabicString
+static void visualGlyphs(char *glyphs, unsigned int length)
+{
+    uint8_t classes[64], levels[64];
+    for (unsigned int i = 0; i < length; i++)
+        classes[i] = DMDBidi::glyphClass((uint8_t)glyphs[i]);
+    DMDBidi::resolve(classes, length, 1, levels);
+    DMDBidi::reorder(glyphs, levels, length);
+}
+
+static void putUtf8(std::string &out, uint32_t cp)
+{
+    if (cp < 0x80)
+        out += (char)cp;
+    else if (cp < 0x800)
+    {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static void testUtf8()
+{
+    // every maximal part of an invalid sequence is one U+FFFD
+    struct
+    {
+        const char *utf8;
+        uint32_t codepoints[5];
+        unsigned int count, errors;
+    } cases[] = {
+        {"a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", {0x61, 0xE9, 0x20AC, 0x1F600}, 4, 0},
+        {"\xf4\x8f\xbf\xbf\xef\xbf\xbd", {0x10FFFF, 0xFFFD}, 2, 0},
+        {"\xc0\x80", {0xFFFD, 0xFFFD}, 2, 2},             // overlong NUL
+        {"\xe0\x9f\xbf", {0xFFFD, 0xFFFD, 0xFFFD}, 3, 3}, // overlong U+07FF
+        {"\xed\xa0\x80", {0xFFFD, 0xFFFD, 0xFFFD}, 3, 3}, // surrogate
+        {"\xf4\x90\x80\x80", {0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD}, 4, 4},
+        {"\xf0\x9f\x98" "a\xc3", {0xFFFD, 0x61, 0xFFFD}, 3, 2}, // cut short
+        {"\xf5\xff\x80", {0xFFFD, 0xFFFD, 0xFFFD}, 3, 3},
+    };
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        DMDUtf8Iterator text(cases[c].utf8);
+        uint32_t codepoint;
+        unsigned int count = 0;
+        while (text.next(codepoint))
+        {
+            CHECK(count < cases[c].count && codepoint == cases[c].codepoints[count]);
+            count++;
+        }
+        CHECK(count == cases[c].count && text.getErrors() == cases[c].errors);
+        CHECK(text.position() == cases[c].utf8 + strlen(cases[c].utf8));
+    }
+
+    // any scalar value comes back from its encoding, and bytes fed one at a time decode as
+    // the iterator decodes them in place
+    srand(24);
+    for (int n = 0; n < 2000; n++)
+    {
+        std::vector<uint32_t> codepoints;
+        std::string utf8, noise;
+        for (int i = 0; i < 8; i++)
+        {
+            uint32_t cp = (rand() % 4 == 0) ? rand() % 0x80 : rand() % 0x110000;
+            if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF))
+                continue;
+            codepoints.push_back(cp);
+            putUtf8(utf8, cp);
+        }
+        DMDUtf8Iterator text(utf8.c_str());
+        uint32_t codepoint;
+        for (unsigned int i = 0; i < codepoints.size(); i++)
+            CHECK(text.next(codepoint) && codepoint == codepoints[i]);
+        CHECK(!text.next(codepoint) && text.getErrors() == 0);
+
+        for (int i = 0; i < 12; i++)
+            noise += (char)((rand() % 3 == 0) ? 0x80 + rand() % 0x80 : (rand() % 2) ? 0xC0 + rand() % 0x40 : 1 + rand() % 0x7F);
+        DMDUtf8Iterator inPlace(noise.c_str());
+        DMDUtf8Decoder decoder;
+        std::vector<uint32_t> fed;
+        for (unsigned int i = 0; i < noise.size(); i++)
+        {
+            uint8_t result = decoder.push(noise[i], codepoint);
+            if (result != DMD_UTF8_MORE)
+                fed.push_back(codepoint);
+            if (result == DMD_UTF8_AGAIN)
+                i--;
+        }
+        if (decoder.finish(codepoint))
+            fed.push_back(codepoint);
+        for (unsigned int i = 0; i < fed.size(); i++)
+            CHECK(inPlace.next(codepoint) && codepoint == fed[i]);
+        CHECK(!inPlace.next(codepoint) && inPlace.getErrors() == decoder.getErrors());
+    }
+
+    // the printable ASCII prefix stops at the first byte outside 0x20-0x7E, wherever it is
+    char line[24];
+    const uint8_t stops[] = {0x00, 0x1F, 0x7F, 0x80, 0xD8, 0xFF};
+    for (unsigned int length = 0; length < sizeof(line); length++)
+    {
+        for (unsigned int i = 0; i < length; i++)
+            line[i] = (i & 1) ? 0x20 : 0x7E;
+        CHECK(dmdAsciiPrefix(line, length) == length);
+        for (unsigned int at = 0; at < length; at++)
+            for (unsigned int s = 0; s < sizeof(stops); s++)
+            {
+                line[at] = stops[s];
+                CHECK(dmdAsciiPrefix(line, length) == at);
+                line[at] = 'x';
+            }
+    }
+
+    // shaping takes ASCII as is, an invalid or astral codepoint breaks a join and draws nothing,
+    // and a streamed source decodes the same way, reading the visual order from the right
+    struct
+    {
+        const char *utf8;
+        const char *glyphs;
+    } shaped[] = {
+        {"The quick brown fox 0123456789", "The quick brown fox 0123456789"},
+        {"abc \xd8\xa8\xd9\x83", "abc \x8b\xd4"},
+        {"\xd8\xa8\xf0\x9f\x98\x80\xd8\xa8", "\x89\x89"},
+        {"\xf0\x90\x98\xa8", ""}, // U+10628 is not beh
+        {"\xd8\xa8\xd8\xd9\x83\xc3", "\x89\xd3"},
+    };
+    DMD dmd(1, 1);
+    for (unsigned c = 0; c < sizeof(shaped) / sizeof(shaped[0]); c++)
+    {
+        char glyphs[64];
+        unsigned int length = dmd.utf8ToArabic(shaped[c].utf8, glyphs, sizeof(glyphs));
+        CHECK(length == strlen(shaped[c].glyphs) && strcmp(glyphs, shaped[c].glyphs) == 0);
+        DMDStringSource utf8(shaped[c].utf8);
+        DMDArabicSource source(&utf8);
+        visualGlyphs(glyphs, length);
+        for (unsigned int i = length; i-- > 0;)
+            CHECK(source.next() == (uint8_t)glyphs[i]);
+        CHECK(source.next() == DMD_TEXT_END);
+    }
+    char small[8];
+    CHECK(dmd.utf8ToArabic("The quick brown fox", small, sizeof(small)) == 7 && strcmp(small, "The qui") == 0);
+}
+
+static void testLongText()
+{
+    // nothing is cut at 255 characters any more
+    std::string text;
+    for (int i = 0; i < 40; i++)
+        text += "0123456789";
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.clearScreen(true);
+    dmd.drawMarquee(text.c_str(), text.size(), 0, 0);
+    int x = 0;
+    while (x > -2300)
+    {
+        if (dmd.stepMarquee(-37, 0))
+            break;
+        x -= 37;
+    }
+    fresh.clearScreen(true);
+    fresh.drawString(x, 0, text.c_str(), text.size(), GRAPHICS_NORMAL);
+    CHECK(x < -2300);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+
+    std::string arabic;
+    for (int i = 0; i < 60; i++)
+        arabic += "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 ";
+    std::string glyphs(arabic.size() + 1, '\0');
+    CHECK(dmd.utf8ToArabic(arabic.c_str(), &glyphs[0], glyphs.size()) == 360);
+}
+
+static void testShapeCache()
+{
+    // cached shaping draws what shaping every call draws, each phrase and font shaped once
+    const char *phrases[] = {"\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7", "\xd8\xb3\xd9\x84\xd8\xa7\xd9\x85 12",
+                             "\xd8\xa8\xd9\x83\xd9\x85"};
+    DMDShapeCache cache(2);
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.setShapeCache(&cache);
+    const char *fonts[] = {"ArabicFont", "SystemFont5x7"};
+    for (int f = 0; f < 2; f++)
+    {
+        dmd.selectFont(hostFindFont(fonts[f]));
+        fresh.selectFont(hostFindFont(fonts[f]));
+        for (int n = 0; n < 6; n++)
+        {
+            const char *text = phrases[n % 2];
+            dmd.clearScreen(true);
+            fresh.clearScreen(true);
+            dmd.drawArabicString(60 - 3 * n, 2, text, GRAPHICS_NORMAL);
+            fresh.drawArabicString(60 - 3 * n, 2, text, GRAPHICS_NORMAL);
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+        }
+    }
+    CHECK(cache.getMisses() == 4 && cache.getHits() == 8);
+
+    // a third phrase replaces the least recently used one, and a marquee restart is a hit
+    dmd.drawArabicString(0, 0, phrases[0], GRAPHICS_NORMAL);
+    dmd.drawArabicString(0, 0, phrases[2], GRAPHICS_NORMAL);
+    dmd.drawArabicString(0, 0, phrases[0], GRAPHICS_NORMAL);
+    CHECK(cache.getMisses() == 5 && cache.getHits() == 10);
+    dmd.clearScreen(true);
+    fresh.clearScreen(true);
+    dmd.drawArabicMarquee(phrases[2], 64, 0);
+    fresh.drawArabicMarquee(phrases[2], 64, 0);
+    CHECK(cache.getMisses() == 5 && cache.getHits() == 11);
+    for (int n = 0; n < 40; n++)
+    {
+        dmd.stepMarquee(-1, 0);
+        fresh.stepMarquee(-1, 0);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+    dmd.drawArabicString(0, 0, phrases[1], GRAPHICS_NORMAL);
+    CHECK(cache.getMisses() == 6);
+
+    cache.clear();
+    CHECK(cache.getHits() == 0 && cache.getMisses() == 0);
+    dmd.drawArabicString(0, 0, phrases[0], GRAPHICS_NORMAL);
+    CHECK(cache.getMisses() == 1);
+}
+
+// Bidi class of the few codepoints the conformance cases use
+static uint8_t bidiClassOf(unsigned long cp)
+{
+    if ((cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z'))
+        return DMD_BIDI_L;
+    if ((cp >= '0' && cp <= '9') || cp == 0x06F3)
+        return DMD_BIDI_EN;
+    switch (cp)
+    {
+    case 0x05D0:
+        return DMD_BIDI_R;
+    case 0x0628:
+    case 0x0644:
+        return DMD_BIDI_AL;
+    case 0x0661:
+        return DMD_BIDI_AN;
+    case '+':
+    case '-':
+        return DMD_BIDI_ES;
+    case '#':
+    case '$':
+    case '%':
+        return DMD_BIDI_ET;
+    case ',':
+    case '.':
+    case '/':
+    case ':':
+    case 0x060C:
+        return DMD_BIDI_CS;
+    case 0x0300:
+        return DMD_BIDI_NSM;
+    case '\t':
+        return DMD_BIDI_S;
+    case ' ':
+        return DMD_BIDI_WS;
+    }
+    return DMD_BIDI_ON;
+}
+
+static void testBidi()
+{
+    // lines of BidiCharacterTest.txt: codepoints; paragraph direction (2 auto); paragraph level;
+    // levels; visual order. Made with ICU, without brackets as they are paired there (N0)
+    static const char *cases[] = {
+    "0025 005A 05D0 0061 0062 0661 060C 0300 003B 0300 0300 002B;0;0;0 0 1 0 0 2 0 0 0 0 0 0;0 1 2 3 4 5 6 7 8 9 10 11",
+    "0024 002F 002F 002B 002F 0022 0022 0031 060C 003D 0628;1;1;1 1 1 1 1 1 1 2 1 1 1;10 9 8 7 6 5 4 3 2 1 0",
+    "002A 0023 005A 003A 0037 06F3 002A 0062;2;0;0 0 0 0 0 0 0 0;0 1 2 3 4 5 6 7",
+    "002A 0021 0023 0024 0009 0062 0644 0009 0023;0;0;0 0 0 0 0 0 1 0 0;0 1 2 3 4 5 6 7 8",
+    "0037 0020 05D0 06F3 06F3 0009 0061 0661 0628 003D;1;1;2 1 1 2 2 1 2 2 1 1;9 8 6 7 5 3 4 2 1 0",
+    "002E 0020 002E 003A 005A 002E 060C 003B 002F 002C;2;0;0 0 0 0 0 0 0 0 0 0;0 1 2 3 4 5 6 7 8 9",
+    "0023 0020 0022 003B;0;0;0 0 0 0;0 1 2 3",
+    "002A 060C 003D 002D;1;1;1 1 1 1;3 2 1 0",
+    "002F 0031 0300 060C 0061 0300 0022 0628 002A 005A;2;0;0 0 0 0 0 0 0 1 0 0;0 1 2 3 4 5 6 7 8 9",
+    "0037 002B;0;0;0 0;0 1",
+    "06F3 003A 0024 0031 0037 0061 060C;1;1;2 1 2 2 2 2 1;6 2 3 4 5 1 0",
+    "0020 06F3 0061 0025 0644 0023 06F3 0661 0062 060C 0024;2;0;0 0 0 0 1 1 2 2 0 0 0;0 1 2 3 6 7 5 4 8 9 10",
+    "06F3 0031 0023 0300 05D0 0300 0009 0661 0037 002A 002B;0;0;0 0 0 0 1 1 0 2 2 0 0;0 1 2 3 5 4 6 7 8 9 10",
+    "0024 002E 0021;1;1;1 1 1;2 1 0",
+    "002F 0644 002E 0061 002C;2;1;1 1 1 2 1;4 3 2 1 0",
+    "0644 0023 0300 0037 0023;0;0;1 1 1 2 0;3 2 1 0 4",
+    "003B 003A 0024 0022 002F 060C 003B 0020 003A;1;1;1 1 1 1 1 1 1 1 1;8 7 6 5 4 3 2 1 0",
+    "0020 003D 0031 0062 0025 0020 002B;2;0;0 0 0 0 0 0 0;0 1 2 3 4 5 6",
+    "0628 060C 003D 0020 060C 05D0 0061 002F 0037 0300 002A 060C;0;0;1 1 1 1 1 1 0 0 0 0 0 0;5 4 3 2 1 0 6 7 8 9 10 11",
+    "0020 06F3 0300 002D 003B 003A;1;1;1 2 2 1 1 1;5 4 3 1 2 0",
+    "06F3;2;0;0;0",
+    "002D 0061;0;0;0 0;0 1",
+    "002F 0009 0062 06F3 002A 0020 0644 0024 002F;1;1;1 1 2 2 1 1 1 1 1;8 7 6 5 4 2 3 1 0",
+    "003B 0020;2;0;0 0;0 1",
+    };
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        uint8_t classes[16], levels[16];
+        char order[16];
+        unsigned int length = 0;
+        char *p = (char *)cases[c];
+        while (*p != ';')
+        {
+            classes[length] = bidiClassOf(strtoul(p, &p, 16));
+            order[length] = length;
+            length++;
+        }
+        int direction = strtol(p + 1, &p, 10);
+        int paragraphLevel = strtol(p + 1, &p, 10);
+        uint8_t level = DMDBidi::resolve(classes, length, direction == 2 ? DMD_BIDI_AUTO : direction, levels);
+        CHECK(level == paragraphLevel);
+        p++;
+        for (unsigned int i = 0; i < length; i++)
+            CHECK(levels[i] == strtol(p, &p, 10));
+        DMDBidi::reorder(order, levels, length);
+        p++;
+        for (unsigned int i = 0; i < length; i++)
+            CHECK(order[i] == strtol(p, &p, 10));
+    }
+
+    // shaped glyphs: words and numbers keep their order inside right to left text, and the
+    // brackets are mirrored so they still enclose the text they did
+    struct
+    {
+        const char *glyphs;
+        const char *visual;
+    } glyphCases[] = {
+        {"\x89 abc 12", "abc 12 \x89"},
+        {"\x89 (12) \x8b", "\x8b (12) \x89"},
+        {"abc \x89\x8b 3.5%", "%3.5 \x8b\x89 abc"},
+    };
+    for (unsigned c = 0; c < sizeof(glyphCases) / sizeof(glyphCases[0]); c++)
+    {
+        char text[32];
+        uint8_t classes[32], levels[32];
+        unsigned int length = strlen(glyphCases[c].glyphs);
+        strcpy(text, glyphCases[c].glyphs);
+        for (unsigned int i = 0; i < length; i++)
+            classes[i] = DMDBidi::glyphClass((uint8_t)text[i]);
+        DMDBidi::resolve(classes, length, 1, levels);
+        DMDBidi::reorder(text, levels, length);
+        CHECK(strcmp(text, glyphCases[c].visual) == 0);
+    }
+
+    // drawArabicString draws the visual order
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.selectFont(hostFindFont("ArabicFont"));
+    fresh.selectFont(hostFindFont("ArabicFont"));
+    dmd.clearScreen(true);
+    fresh.clearScreen(true);
+    dmd.drawArabicString(0, 0, "\xd8\xa8 abc 12", GRAPHICS_NORMAL);
+    fresh.drawStringCompact(0, 0, "abc 12 \x89", 8, GRAPHICS_NORMAL);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+}
+
+static void testMeasure()
+{
+    // the advance table holds what the font in flash does, and text drawn where measured
+    // text ends continues it
+    const char *fonts[] = {"SystemFont5x7", "Arial_14", "Arial_Black_16_ISO_8859_1", "ArabicFont"};
+    srand(25);
+    for (unsigned f = 0; f < sizeof(fonts) / sizeof(fonts[0]); f++)
+    {
+        const uint8_t *font = hostFindFont(fonts[f]);
+        DMD dmd(4, 1), fresh(4, 1);
+        dmd.selectFont(font);
+        fresh.selectFont(font);
+        for (int c = 0; c < 256; c++)
+            CHECK(dmd.charWidth(c) == charWidthOfFont(c, font));
+        for (int n = 0; n < 200; n++)
+        {
+            char text[12];
+            unsigned int length = rand() % sizeof(text);
+            for (unsigned int i = 0; i < length; i++)
+                text[i] = (rand() % 4 == 0) ? ' ' : 0x20 + rand() % 0xE0;
+            unsigned int split = rand() % (length + 1);
+            int width = dmd.measureString(text, split);
+            dmd.clearScreen(true);
+            fresh.clearScreen(true);
+            dmd.drawString(3, 0, text, length, GRAPHICS_NORMAL);
+            fresh.drawString(3, 0, text, split, GRAPHICS_NORMAL);
+            fresh.drawString(3 + width + (width > 0), 0, text + split, length - split, GRAPHICS_NORMAL);
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+
+            width = dmd.measureStringCompact(text, split);
+            dmd.clearScreen(true);
+            fresh.clearScreen(true);
+            dmd.drawStringCompact(3, 0, text, length, GRAPHICS_NORMAL);
+            fresh.drawStringCompact(3, 0, text, split, GRAPHICS_NORMAL);
+            fresh.drawStringCompact(3 + width, 0, text + split, length - split, GRAPHICS_NORMAL);
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+        }
+    }
+
+    // Arabic is measured as it is shaped, or from the shape cache, and right aligned it ends
+    // at the box edge
+    const char *phrases[] = {"\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 abc 12", "Hello",
+                             "\xd9\x84\xd8\xa7 \xd8\xa8\xd9\x83\xd9\x85\xf0\x9f\x98\x80"};
+    DMDShapeCache cache(4);
+    DMD dmd(4, 1), fresh(4, 1);
+    dmd.selectFont(hostFindFont("ArabicFont"));
+    fresh.selectFont(hostFindFont("ArabicFont"));
+    for (unsigned p = 0; p < sizeof(phrases) / sizeof(phrases[0]); p++)
+    {
+        char glyphs[64];
+        unsigned int length = dmd.utf8ToArabic(phrases[p], glyphs, sizeof(glyphs));
+        int width = dmd.measureArabic(phrases[p]);
+        CHECK(width == dmd.measureStringCompact(glyphs, length));
+        dmd.clearScreen(true);
+        fresh.clearScreen(true);
+        dmd.drawArabicAligned(10, 120, 1, phrases[p], DMD_ALIGN_RIGHT, GRAPHICS_NORMAL);
+        fresh.drawArabicString(121 - width, 1, phrases[p], GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+        dmd.setShapeCache(&cache);
+        dmd.drawArabicString(0, 0, phrases[p], GRAPHICS_NORMAL);
+        CHECK(dmd.measureArabic(phrases[p]) == width);
+        dmd.setShapeCache(NULL);
+    }
+    CHECK(cache.getHits() == 2);
+
+    // alignment in a box, and justified text reaching both edges
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    CHECK(DMD::alignX(20, 10, 49, DMD_ALIGN_LEFT) == 10 && DMD::alignX(20, 10, 49, DMD_ALIGN_JUSTIFY) == 10);
+    CHECK(DMD::alignX(20, 10, 49, DMD_ALIGN_CENTER) == 20 && DMD::alignX(20, 10, 49, DMD_ALIGN_RIGHT) == 30);
+    const char *text = "ab cd ef";
+    int width = dmd.measureString(text, 8), word = dmd.measureString("ab", 2), space = dmd.charWidth(' ');
+    CHECK(width == 3 * word + 2 * (space + 2));
+    const struct
+    {
+        byte align;
+        int x2, x;
+    } boxes[] = {
+        {DMD_ALIGN_CENTER, 100, 5 + (96 - width) / 2},
+        {DMD_ALIGN_RIGHT, 100, 101 - width},
+        {DMD_ALIGN_JUSTIFY, 4 + width, 5},  // fits exactly, drawn as it is
+        {DMD_ALIGN_JUSTIFY, 3 + width, 5},  // too wide, left aligned
+    };
+    for (unsigned b = 0; b < sizeof(boxes) / sizeof(boxes[0]); b++)
+    {
+        dmd.clearScreen(true);
+        fresh.clearScreen(true);
+        dmd.drawStringAligned(5, boxes[b].x2, 2, text, 8, boxes[b].align, GRAPHICS_NORMAL);
+        fresh.drawString(boxes[b].x, 2, text, 8, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+    // 5 columns more, the first space takes 3 of them and the second 2
+    dmd.clearScreen(true);
+    fresh.clearScreen(true);
+    dmd.drawStringAligned(5, 9 + width, 2, text, 8, DMD_ALIGN_JUSTIFY, GRAPHICS_NORMAL);
+    fresh.drawString(5, 2, "ab", 2, GRAPHICS_NORMAL);
+    fresh.drawString(5 + word + space + 5, 2, "cd", 2, GRAPHICS_NORMAL);
+    fresh.drawString(5 + 2 * word + 2 * space + 9, 2, "ef", 2, GRAPHICS_NORMAL);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    CHECK(5 + 2 * word + 2 * space + 9 + word - 1 == 9 + width);
+
+    // justified Arabic words spread over the box, with no spaces it is right aligned
+    const char *arabic = "\xd8\xa8\xd9\x83\xd9\x85 \xd8\xa8";
+    dmd.selectFont(hostFindFont("ArabicFont"));
+    fresh.selectFont(hostFindFont("ArabicFont"));
+    char glyphs[16];
+    unsigned int length = dmd.utf8ToArabic(arabic, glyphs, sizeof(glyphs));
+    uint8_t levels[] = {1, 1, 1, 1, 1};
+    DMDBidi::reorder(glyphs, levels, length);
+    CHECK(length == 5 && glyphs[1] == ' ');
+    int right = dmd.measureStringCompact(glyphs + 2, 3);
+    dmd.clearScreen(true);
+    fresh.clearScreen(true);
+    dmd.drawArabicAligned(0, 127, 0, arabic, DMD_ALIGN_JUSTIFY, GRAPHICS_NORMAL);
+    fresh.drawStringCompact(0, 0, glyphs, 1, GRAPHICS_NORMAL);
+    fresh.drawStringCompact(128 - right, 0, glyphs + 2, 3, GRAPHICS_NORMAL);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    dmd.clearScreen(true);
+    fresh.clearScreen(true);
+    dmd.drawArabicAligned(0, 127, 0, "\xd8\xa8\xd9\x83\xd9\x85", DMD_ALIGN_JUSTIFY, GRAPHICS_NORMAL);
+    fresh.drawArabicString(128 - right, 0, "\xd8\xa8\xd9\x83\xd9\x85", GRAPHICS_NORMAL);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+}
+
+static void testMarqueeSource()
+{
+    // a streamed string scrolls exactly like the same text drawn where it has got to
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.clearScreen(true);
+    DMDStringSource hello("Hello World");
+    dmd.drawMarquee(&hello, 0);
+    int x = 64, n = 0;
+    for (;;)
+    {
+        x -= 3;
+        if (dmd.stepMarquee(-3, 0))
+            break;
+        fresh.clearScreen(true);
+        fresh.drawString(x, 0, "Hello World", 11, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+        CHECK(++n < 100);
+    }
+    // starts over on the step the last column goes off
+    CHECK(x + 64 < 0 && x + 67 >= 0);
+
+    // text written while it scrolls carries on from the right edge once it arrives
+    DMDRingSource ring(15);
+    CHECK(ring.write("Hi") == 2);
+    dmd.clearScreen(true);
+    dmd.drawMarquee(&ring, 0);
+    for (int i = 0; i < 40; i++)
+        CHECK(!dmd.stepMarquee(-1, 0));
+    CHECK(ring.write(" there, and more") == 15);
+    ring.close();
+    for (int i = 0; i < 11; i++)
+        dmd.stepMarquee(-1, 0);
+    fresh.clearScreen(true);
+    fresh.drawString(13, 0, "Hi", 2, GRAPHICS_NORMAL);
+    fresh.drawString(53, 0, " there, and mor", 15, GRAPHICS_NORMAL);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+
+    // a writer on another thread, the reader sees every byte once and in order
+    DMDRingSource shared(7);
+    std::thread writer([&shared]()
+                       {
+                           for (int i = 0; i < 20000;)
+                           {
+                               char c = 'a' + i % 26;
+                               if (shared.write(&c, 1) == 1)
+                                   i++;
+                               else
+                                   std::this_thread::yield();
+                           }
+                           shared.close();
+                       });
+    int read = 0, c;
+    while ((c = shared.next()) != DMD_TEXT_END)
+    {
+        if (c == DMD_TEXT_PENDING)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        CHECK(c == 'a' + read % 26);
+        read++;
+    }
+    writer.join();
+    CHECK(read == 20000);
+
+    // Arabic shaped on the way in gives the glyphs utf8ToArabic does, and enters from the left
+    const char *text = "\xd9\x84\xd8\xa7 \xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 \xd8\xa8\xd9\x83\xd9\x85";
+    char glyphs[64];
+    unsigned int length = dmd.utf8ToArabic(text, glyphs, sizeof(glyphs));
+    DMDStringSource utf8(text);
+    DMDArabicSource shaped(&utf8);
+    int width = 0;
+    for (unsigned int i = 0; i < length; i++)
+    {
+        CHECK(shaped.next() == (uint8_t)glyphs[i]);
+        width += dmd.charWidth(glyphs[i]);
+    }
+    CHECK(shaped.next() == DMD_TEXT_END);
+    CHECK(shaped.rewind());
+
+    dmd.selectFont(hostFindFont("ArabicFont"));
+    fresh.selectFont(hostFindFont("ArabicFont"));
+    width = 0;
+    for (unsigned int i = 0; i < length; i++)
+        width += dmd.charWidth(glyphs[i]);
+    dmd.clearScreen(true);
+    dmd.drawMarquee(&shaped, 1, true);
+    for (n = 1; n <= 30; n++)
+    {
+        dmd.stepMarquee(2, 0);
+        fresh.clearScreen(true);
+        fresh.drawArabicString(2 * n - width, 1, text, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+
+    // mixed with Latin and numbers, the glyphs read from the right of drawArabicString's order
+    const char *mixed[] = {"\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 abc 12",
+                           "abc \xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 3.5% (x)",
+                           "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 12, 34 \xd8\xa8\xd9\x83\xd9\x85",
+                           "(\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7) - abc! \xd9\x85 #5"};
+    for (int t = 0; t < 4; t++)
+    {
+        length = dmd.utf8ToArabic(mixed[t], glyphs, sizeof(glyphs));
+        visualGlyphs(glyphs, length);
+        DMDStringSource mixedUtf8(mixed[t]);
+        DMDArabicSource mixedShaped(&mixedUtf8);
+        for (unsigned int i = length; i-- > 0;)
+            CHECK(mixedShaped.next() == (uint8_t)glyphs[i]);
+        CHECK(mixedShaped.next() == DMD_TEXT_END);
+    }
+
+    // a longer Latin run than is held back comes out whole, in pieces
+    std::string latin(DMD_ARABIC_SOURCE_RUN + 10, 'a');
+    DMDStringSource latinUtf8(latin.c_str());
+    DMDArabicSource latinShaped(&latinUtf8);
+    for (int i = 0; i < DMD_ARABIC_SOURCE_RUN + 10; i++)
+        CHECK(latinShaped.next() == 'a');
+    CHECK(latinShaped.next() == DMD_TEXT_END);
+}
+
+static void testMarqueeSpeed()
+{
+    // the pixels moved always match the time gone at the speed, whatever the call pattern
+    const uint32_t gaps[] = {16000, 17000, 3000, 40000, 250000, 1, 16667, 33000, 9000, 120000};
+    DMDScrollClock clock;
+    clock.setSpeed(DMD_SPEED(30.5), DMD_SPEED(-7.25));
+    int amountX, amountY;
+    uint32_t now = 0xFFFF0000; // runs across the micros() wrap
+    CHECK(!clock.advance(now, amountX, amountY));
+    long long elapsed = 0, movedX = 0, movedY = 0;
+    for (int n = 0; n < 50; n++)
+    {
+        uint32_t gap = gaps[n % (sizeof(gaps) / sizeof(gaps[0]))];
+        now += gap;
+        elapsed += gap;
+        clock.advance(now, amountX, amountY);
+        movedX += amountX;
+        movedY += amountY;
+        CHECK(movedX == elapsed * 61 / 2000000);
+        CHECK(movedY == -(elapsed * 29 / 4000000));
+    }
+
+    // a late call catches up in one step, to where the text would have got to
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.clearScreen(true);
+    dmd.drawMarquee("Hello World", 11, 64, 0);
+    dmd.setMarqueeSpeed(DMD_SPEED(-40), 0);
+    now = 5000;
+    dmd.updateMarquee(now);
+    elapsed = 0;
+    for (int n = 0; n < 20; n++)
+    {
+        uint32_t gap = gaps[n % (sizeof(gaps) / sizeof(gaps[0]))];
+        now += gap;
+        elapsed += gap;
+        CHECK(!dmd.updateMarquee(now));
+        fresh.clearScreen(true);
+        fresh.drawString(64 - (int)(elapsed * 40 / 1000000), 0, "Hello World", 11, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+}
+
+template <byte W, byte H>
+static void checkFixedLayout()
+{
+    // the object's own storage holds the same frame as a runtime DMD of the same size, and the
+    // two constant addressed accessors agree with writePixel/readPixelLevel; drawing is DMD's code
+    DMDFixed<W, H> fixed;
+    DMD dmd(W, H);
+    CHECK(fixed.getWidth() == dmd.getWidth() && fixed.getHeight() == dmd.getHeight());
+    fixed.clearScreen(true);
+    dmd.clearScreen(true);
+    uint32_t seed = W * 31 + H;
+    for (int n = 0; n < 3000; n++)
+    {
+        seed = seed * 1103515245 + 12345;
+        unsigned int x = (seed >> 8) % (dmd.getWidth() + 8), y = (seed >> 18) % (dmd.getHeight() + 4);
+        byte mode = (seed >> 4) % (GRAPHICS_AND + 1);
+        byte level = (seed >> 28) % (DMD_MAX_INTENSITY + 1);
+        fixed.setIntensity(level);
+        dmd.setIntensity(level);
+        if (n & 1)
+            fixed.writePixelFixed(x, y, mode, (seed >> 30) & 1);
+        else
+            fixed.writePixel(x, y, mode, (seed >> 30) & 1);
+        dmd.writePixel(x, y, mode, (seed >> 30) & 1);
+        CHECK(fixed.readPixelLevelFixed(x, y) == dmd.readPixelLevel(x, y));
+        CHECK(fixed.readPixelLevel(x, y) == dmd.readPixelLevel(x, y));
+    }
+    fixed.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fixed.drawString(3, 5, "Fixed", 5, GRAPHICS_TOGGLE);
+    dmd.drawString(3, 5, "Fixed", 5, GRAPHICS_TOGGLE);
+    CHECK(dmdFrameAscii(fixed) == dmdFrameAscii(dmd));
+    int x1, y1, x2, y2;
+    CHECK(fixed.getDirtyRect(x1, y1, x2, y2));
+}
+
+static void testFixedLayout()
+{
+    checkFixedLayout<1, 1>();
+    checkFixedLayout<2, 1>();
+    checkFixedLayout<3, 2>();
+    checkFixedLayout<1, 4>();
+}
+
+static void testContainer()
+{
+    // the block copy lands every container pixel where writePixel would, in every mode
+    const int places[][4] = {{5, 3, 40, 12}, {0, 0, 64, 32}, {50, 25, 33, 11}, {-9, -4, 30, 16}, {33, 17, 1, 1}};
+    for (unsigned p = 0; p < sizeof(places) / sizeof(places[0]); p++)
+    {
+        DMDContainer container(places[p][0], places[p][1], places[p][2], places[p][3]);
+        container.setFont(hostFindFont("SystemFont5x7"));
+        container.appendText(0, 0, "Packed 1bpp", 11);
+        container.appendText(3, 7, "rows", 4);
+        CHECK(container.getStride() % 4 == 0);
+        // plus noise written straight into the packed rows
+        uint8_t *buf = container.getBufferData();
+        for (int i = 0; i < container.getStride() * container.getH(); i += 3)
+            buf[i] ^= (uint8_t)(i * 37);
+
+        for (byte mode = GRAPHICS_NORMAL; mode <= GRAPHICS_AND; mode++)
+        {
+            DMD dmd(2, 2), ref(2, 2);
+            dmd.drawTestPattern(PATTERN_ALT_0);
+            ref.drawTestPattern(PATTERN_ALT_0);
+            dmd.drawContainer(&container, mode);
+            for (int y = 0; y < container.getH(); y++)
+                for (int x = 0; x < container.getW(); x++)
+                    ref.writePixel(x + container.getX0(), y + container.getY0(), mode, container.getPixel(x, y));
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(ref));
+        }
+    }
+}
+
+static void fillNoise(DMDContainer &container, int seed)
+{
+    uint8_t *buf = container.getBufferData();
+    for (int i = 0; i < container.getStride() * container.getCanvasH(); i++)
+        buf[i] = (uint8_t)((i + seed) * 37 + (i >> 3));
+    container.setDirty(true);
+}
+
+static void testContainerGlyphs()
+{
+    // appendChar writes exactly the glyph pixels inside the canvas, whatever the font, place
+    // and canvas size, and leaves everything else alone
+    uint32_t seed = 12345;
+    for (int n = 0; n < 4000; n++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const HostFont &hf = hostFonts[(seed >> 8) % hostFontCount];
+        int canvasW = 1 + (seed >> 16) % 90, canvasH = 1 + (seed >> 24) % 40;
+        seed = seed * 1103515245 + 12345;
+        int x = (int)((seed >> 8) % 140) - 40, y = (int)((seed >> 16) % 90) - 40;
+        uint8_t letter = (seed >> 24) & 0xFF;
+
+        DMDContainer container(n % 7, n % 5, canvasW, canvasH);
+        container.setFont(hf.data);
+        fillNoise(container, n);
+        int size = container.getStride() * canvasH;
+        std::vector<uint8_t> expected(container.getBufferData(), container.getBufferData() + size);
+
+        DMDFont font;
+        font.attach(hf.data);
+        uint8_t width = font.getWidth(letter), height = font.getHeight();
+        const uint8_t *glyph = font.getGlyph(letter);
+        if (glyph != NULL && letter != ' ')
+        {
+            uint8_t bytes = font.getBytesPerColumn();
+            int rows = (bytes == 1) ? ((height < 8) ? height + 1 : 8) : height;
+            for (int j = 0; j < width; j++)
+                for (int r = 0; r < rows; r++)
+                {
+                    int px = x + j, py = y + r;
+                    if (px < 0 || py < 0 || px >= canvasW || py >= canvasH)
+                        continue;
+                    // row r is in the last byte for the bottom rows of multi byte columns
+                    int i = r / 8, bit = r % 8;
+                    if (bytes > 1 && i >= bytes - 1)
+                    {
+                        i = bytes - 1;
+                        bit = r - (height - 8);
+                    }
+                    uint8_t mask = 0x80 >> (px & 7);
+                    uint8_t &b = expected[py * container.getStride() + px / 8];
+                    b = (glyph[j + i * width] >> bit & 1) ? (b & ~mask) : (b | mask);
+                }
+        }
+
+        uint8_t advance = container.appendChar(x, y, letter);
+        CHECK(advance == (letter == ' ' ? font.getWidth('n') : width));
+        CHECK(memcmp(container.getBufferData(), &expected[0], size) == 0);
+    }
+}
+
+static void testContainerScroll()
+{
+    // the window shows the canvas from the scroll offset, repeated when wrapping
+    DMDContainer container(7, 5, 45, 20, 70, 13);
+    fillNoise(container, 6);
+    const int scrolls[][2] = {{0, 0}, {13, 2}, {-20, -6}, {69, 12}, {100, 40}, {-141, -27}, {31, 0}};
+    for (int wrap = 0; wrap < 2; wrap++)
+    {
+        container.setWrap(wrap);
+        for (unsigned s = 0; s < sizeof(scrolls) / sizeof(scrolls[0]); s++)
+        {
+            container.setScroll(scrolls[s][0], scrolls[s][1]);
+            DMD dmd(2, 2), ref(2, 2);
+            dmd.drawTestPattern(PATTERN_ALT_1);
+            ref.drawTestPattern(PATTERN_ALT_1);
+            dmd.drawContainer(&container, GRAPHICS_TOGGLE);
+            for (int y = 0; y < container.getH(); y++)
+                for (int x = 0; x < container.getW(); x++)
+                {
+                    int cx = x + scrolls[s][0], cy = y + scrolls[s][1];
+                    if (wrap)
+                    {
+                        cx = ((cx % 70) + 70) % 70;
+                        cy = ((cy % 13) + 13) % 13;
+                    }
+                    ref.writePixel(x + 7, y + 5, GRAPHICS_TOGGLE, container.getPixel(cx, cy));
+                }
+            CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(ref));
+        }
+    }
+
+    // scrolling marks the container dirty only when the offset moves
+    container.setDirty(false);
+    container.setScroll(31, 0);
+    CHECK(!container.isDirty());
+    container.scrollBy(75, -1);
+    CHECK(container.isDirty());
+    CHECK(container.getScrollX() == 36 && container.getScrollY() == 12);
+
+    // text drawn once runs through the window by scrolling alone
+    DMD dmd(2, 1), fresh(2, 1);
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    DMDContainer ticker(0, 0, 64, 16, 128, 16);
+    ticker.setFont(hostFindFont("SystemFont5x7"));
+    ticker.appendText(0, 0, "Hello World", 11);
+    DMDCompositor compositor(&dmd);
+    compositor.add(&ticker, 0);
+    dmd.clearScreen(true);
+    for (int n = -64; n < 70; n += 3)
+    {
+        ticker.setScroll(n, 0);
+        compositor.compose();
+        fresh.clearScreen(true);
+        fresh.drawString(-n, 0, "Hello World", 11, GRAPHICS_NORMAL);
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+}
+
+static void testCompositor()
+{
+    // every compose leaves the frame a full redraw of the layers in z order would
+    DMD dmd(2, 2), ref(2, 2);
+    DMDContainer clock(0, 0, 40, 16), ticker(0, 16, 64, 16), logo(30, 4, 20, 20), badge(-5, 20, 30, 30);
+    fillNoise(clock, 1);
+    fillNoise(ticker, 2);
+    fillNoise(logo, 3);
+    fillNoise(badge, 4);
+    DMDCompositor compositor(&dmd);
+    compositor.add(&logo, 2, GRAPHICS_OR);
+    compositor.add(&clock, 0);
+    compositor.add(&ticker, 1);
+    compositor.add(&badge, 3, GRAPHICS_TOGGLE);
+    compositor.setClip(&badge, 0, 24, 20, 29);
+    dmd.clearScreen(true);
+
+    // the layers of each frame bottom up: container, mode, clipped
+    DMDContainer *layers[6][4] = {{&clock, &ticker, &logo, &badge}, {&clock, &ticker, &logo, &badge},
+                                  {&clock, &ticker, &logo, &badge}, {&ticker, &logo, &badge},
+                                  {&logo, &ticker, &badge}, {&logo, &ticker, &badge}};
+    for (int frame = 0; frame < 6; frame++)
+    {
+        if (frame == 1)
+            logo.setPosition(36, 10);
+        if (frame == 2)
+            fillNoise(ticker, 9);
+        if (frame == 3)
+            compositor.remove(&clock);
+        if (frame == 4)
+            compositor.add(&logo, -1, GRAPHICS_AND);
+        if (frame == 5)
+            compositor.clearClip(&badge);
+        // remove redraws the area straight away, leaving compose nothing to do
+        CHECK(compositor.compose() == (frame != 3));
+        CHECK(!compositor.compose());
+
+        ref.clearScreen(true);
+        for (int i = 0; i < 4 && layers[frame][i] != NULL; i++)
+        {
+            DMDContainer *c = layers[frame][i];
+            byte mode = GRAPHICS_NORMAL;
+            if (c == &logo)
+                mode = (frame < 4) ? GRAPHICS_OR : GRAPHICS_AND;
+            if (c == &badge)
+            {
+                mode = GRAPHICS_TOGGLE;
+                if (frame < 5)
+                    ref.setClip(0, 24, 20, 29);
+            }
+            ref.drawContainer(c, mode);
+            ref.clearClip();
+        }
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(ref));
+    }
+
+    // the area of a container that did not change is left alone
+    dmd.writePixel(60, 18, GRAPHICS_TOGGLE, true);
+    fillNoise(badge, 5);
+    CHECK(compositor.compose());
+    ref.clearScreen(true);
+    ref.drawContainer(&logo, GRAPHICS_AND);
+    ref.drawContainer(&ticker, GRAPHICS_NORMAL);
+    ref.drawContainer(&badge, GRAPHICS_TOGGLE);
+    CHECK(dmd.readPixelLevel(60, 18) != ref.readPixelLevel(60, 18));
+    dmd.writePixel(60, 18, GRAPHICS_TOGGLE, true);
+    CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(ref));
+
+    // a clip the sketch set is left as it was
+    dmd.setClip(1, 2, 40, 12);
+    compositor.invalidate();
+    CHECK(compositor.compose());
+    int x1, y1, x2, y2;
+    dmd.getClip(x1, y1, x2, y2);
+    CHECK(x1 == 1 && y1 == 2 && x2 == 40 && y2 == 12);
+}
+
+static void testShiftScreen()
+{
+    DMD dmd(3, 2);
+    dmd.clearScreen(true);
+    dmd.writePixel(31, 15, GRAPHICS_NORMAL, true);
+    dmd.shiftScreen(1, 1);
+    CHECK(dmd.readPixelLevel(32, 16) && !dmd.readPixelLevel(31, 15));
+    dmd.shiftScreen(-40, 0);
+    CHECK(!dmd.readPixelLevel(32, 16));
+    dmd.shiftScreen(-40, 0);
+    dmd.shiftScreen(40, 0);
+    for (int y = 0; y < dmd.getHeight(); y++)
+        for (int x = 0; x < dmd.getWidth(); x++)
+            CHECK(dmd.readPixelLevel(x, y) == 0);
+
+    dmd.writePixel(95, 0, GRAPHICS_NORMAL, true);
+    dmd.shiftScreen(-95, 31);
+    CHECK(dmd.readPixelLevel(0, 31) == DMD_MAX_INTENSITY);
+
+    // shiftRect moves the pixels of the rectangle and leaves the rest alone
+    DMD rect(2, 2), whole(2, 2);
+    const int shifts[][2] = {{-1, 0}, {5, 0}, {-33, 2}, {40, -3}, {0, 1}, {-7, -16}};
+    for (unsigned i = 0; i < sizeof(shifts) / sizeof(shifts[0]); i++)
+    {
+        rect.drawTestPattern(PATTERN_STRIPE_1);
+        whole.drawTestPattern(PATTERN_STRIPE_1);
+        rect.drawCircle(30, 16, 12, GRAPHICS_NORMAL);
+        whole.drawCircle(30, 16, 12, GRAPHICS_NORMAL);
+        std::string before = dmdFrameAscii(rect);
+        rect.shiftRect(0, 0, 63, 31, shifts[i][0], shifts[i][1]);
+        whole.shiftScreen(shifts[i][0], shifts[i][1]);
+        CHECK(dmdFrameAscii(rect) == dmdFrameAscii(whole));
+
+        rect.drawTestPattern(PATTERN_STRIPE_1);
+        rect.drawCircle(30, 16, 12, GRAPHICS_NORMAL);
+        rect.shiftRect(13, 5, 50, 20, shifts[i][0], shifts[i][1]);
+        std::string after = dmdFrameAscii(rect);
+        for (int y = 0; y < 32; y++)
+            for (int x = 0; x < 64; x++)
+            {
+                int sx = x - shifts[i][0], sy = y - shifts[i][1];
+                char expect = before[y * 65 + x];
+                if (x >= 13 && x <= 50 && y >= 5 && y <= 20)
+                    expect = (sx >= 13 && sx <= 50 && sy >= 5 && sy <= 20) ? before[sy * 65 + sx] : '.';
+                CHECK(after[y * 65 + x] == expect);
+            }
+    }
+
+    // fillRect writes what writePixel writes for each pixel of the rectangle inside the clip
+    DMD fill(3, 2), pixels(3, 2);
+    const int rects[][4] = {{0, 0, 95, 31}, {13, 5, 50, 20}, {31, 3, 32, 3}, {-4, 28, 40, 40}, {70, 9, 64, 12}};
+    for (byte mode = GRAPHICS_NORMAL; mode <= GRAPHICS_AND; mode++)
+        for (unsigned i = 0; i < sizeof(rects) / sizeof(rects[0]); i++)
+            for (int clipped = 0; clipped < 2; clipped++)
+            {
+                fill.drawTestPattern(PATTERN_STRIPE_1);
+                pixels.drawTestPattern(PATTERN_STRIPE_1);
+                fill.setIntensity(DMD_MAX_INTENSITY - i % DMD_MAX_INTENSITY);
+                pixels.setIntensity(DMD_MAX_INTENSITY - i % DMD_MAX_INTENSITY);
+                if (clipped)
+                    fill.setClip(20, 4, 70, 25);
+                else
+                    fill.clearClip();
+                fill.clearDirty();
+                fill.fillRect(rects[i][0], rects[i][1], rects[i][2], rects[i][3], mode);
+                int cx1, cy1, cx2, cy2;
+                fill.getClip(cx1, cy1, cx2, cy2);
+                for (int y = rects[i][1]; y <= rects[i][3]; y++)
+                    for (int x = rects[i][0]; x <= rects[i][2]; x++)
+                        if (x >= cx1 && x <= cx2 && y >= cy1 && y <= cy2)
+                            pixels.writePixel(x, y, mode, true);
+                for (int y = 0; y < 32; y++)
+                    for (int x = 0; x < 96; x++)
+                        CHECK(fill.readPixelLevel(x, y) == pixels.readPixelLevel(x, y));
+            }
+    fill.clearClip();
+    fill.clearDirty();
+    fill.fillRect(13, 5, 50, 20, GRAPHICS_INVERSE);
+    int dx1, dx2;
+    CHECK(fill.getDirtyRow(5, dx1, dx2) && dx1 == 13 && dx2 == 50);
+    CHECK(fill.getDirtyRow(20, dx1, dx2) && !fill.getDirtyRow(21, dx1, dx2) && !fill.getDirtyRow(4, dx1, dx2));
+}
+
+static void testMarqueeZones()
+{
+    // two marquees and static text share the display, each zone as if drawn alone into it
+    DMD dmd(2, 1), fresh(2, 1);
+    dmd.selectFont(hostFindFont("SystemFont5x7"));
+    fresh.selectFont(hostFindFont("SystemFont5x7"));
+    dmd.clearScreen(true);
+    dmd.drawString(0, 0, "AB", 2, GRAPHICS_NORMAL);
+
+    DMDMarquee ticker(&dmd, 0, 8, 63, 15), side(&dmd, 30, 0, 63, 7);
+    ticker.selectFont(hostFindFont("SystemFont5x7"));
+    side.selectFont(hostFindFont("Arial_14"));
+    ticker.drawText("Hello World", 11, 64, 0);
+    ticker.setStep(-3, 0);
+    side.drawText("zone 2", 6, -10, -2);
+    side.setStep(1, 0, 2);
+    DMDMarqueeScheduler scheduler;
+    scheduler.add(&ticker);
+    scheduler.add(&side);
+
+    DMDFont sideFont;
+    sideFont.attach(hostFindFont("Arial_14"));
+    int tickerX = 64, sideX = -10;
+    for (int n = 1; n <= 60; n++)
+    {
+        scheduler.step();
+        tickerX -= 3;
+        if (tickerX < -66)
+            tickerX = 64;
+        if (n % 2 == 0)
+            sideX++;
+        fresh.clearScreen(true);
+        fresh.drawString(0, 0, "AB", 2, GRAPHICS_NORMAL);
+        fresh.setClip(0, 8, 63, 15);
+        fresh.drawString(tickerX, 8, "Hello World", 11, GRAPHICS_NORMAL);
+        fresh.setClip(30, 0, 63, 7);
+        int x = 30 + sideX;
+        for (int i = 0; i < 6; i++)
+            x += fresh.drawChar(x, -2, "zone 2"[i], GRAPHICS_NORMAL, sideFont) + 1;
+        fresh.clearClip();
+        CHECK(dmdFrameAscii(dmd) == dmdFrameAscii(fresh));
+    }
+
+    // a clip the sketch set is left as it was
+    dmd.setClip(1, 2, 40, 12);
+    scheduler.step();
+    int x1, y1, x2, y2;
+    dmd.getClip(x1, y1, x2, y2);
+    CHECK(x1 == 1 && y1 == 2 && x2 == 40 && y2 == 12);
+}
+
+// A DMD drawing into RAM the test can also change behind its back
+struct RamDMD : DMD
+{
+    RamDMD(byte *ram)
+        : DMD(2, 1, PIN_DMD_nOE, PIN_DMD_A, PIN_DMD_B, PIN_DMD_CLK, PIN_DMD_LAT, PIN_DMD_R_DATA, ram, NULL, NULL)
+    {
+    }
+};
+
+static void testDirtySpans()
+{
+    static byte ram[2 * DMD_RAM_SIZE_BYTES];
+    RamDMD dmd(ram);
+    dmd.clearScreen(true);
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        dmd.scanDisplayBySPI();
+
+    // every row reports the span drawn into it, and nothing else
+    dmd.clearDirty();
+    CHECK(!dmd.isDirty());
+    dmd.drawFilledBox(5, 3, 40, 6, GRAPHICS_NORMAL);
+    dmd.writePixel(60, 10, GRAPHICS_NORMAL, true);
+    for (int y = 0; y < 16; y++)
+    {
+        int x1 = -2, x2 = -2;
+        boolean dirty = dmd.getDirtyRow(y, x1, x2);
+        if (y >= 3 && y <= 6)
+            CHECK(dirty && x1 == 5 && x2 == 40);
+        else if (y == 10)
+            CHECK(dirty && x1 == 60 && x2 == 60);
+        else
+            CHECK(!dirty && x1 == -2 && x2 == -2);
+    }
+    int x1, y1, x2, y2;
+    CHECK(dmd.getDirtyRect(x1, y1, x2, y2) && x1 == 5 && y1 == 3 && x2 == 60 && y2 == 10);
+    dmd.clearDirty();
+    CHECK(!dmd.isDirty() && !dmd.getDirtyRow(4, x1, x2));
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        dmd.scanDisplayBySPI();
+
+    // a scan restages only the scan lines drawn into: row 0 changed unseen keeps its old bytes
+    // on the bus until a pixel drawn on the same scan line (row 8) marks it
+    const int line0 = 0, line1 = DMD_BITSPERPIXEL * 32;
+    ram[0] = 0x00;
+    dmd.writePixel(60, 9, GRAPHICS_NORMAL, true);
+    hostSpiReset();
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        dmd.scanDisplayBySPI();
+    CHECK(hostSpiLog.bytes[line0 + 3] == 0xFF);
+    CHECK(hostSpiLog.bytes[line1 + 7 * 4 + 1] == 0xF7);
+    dmd.writePixel(0, 8, GRAPHICS_NORMAL, true);
+    hostSpiReset();
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        dmd.scanDisplayBySPI();
+    CHECK(hostSpiLog.bytes[line0 + 3] == 0x00 && hostSpiLog.bytes[line0 + 1] == 0x7F);
+}
+
+static void testScanBusTraffic()
+{
+    DMD dmd(2, 1);
+    dmd.clearScreen(true);
+    dmd.writePixel(0, 0, GRAPHICS_NORMAL, true);
+    hostSpiReset();
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        dmd.scanDisplayBySPI();
+
+    // one transaction per scan line and bit plane, 4 interleaved rows of every panel
+    CHECK(hostSpiLog.transactions == 4 * DMD_BITSPERPIXEL);
+    CHECK(hostSpiLog.bytes.size() == 4 * DMD_BITSPERPIXEL * 4 * 2 * 4);
+    int unlit = 0, lit = 0;
+    for (size_t i = 0; i < hostSpiLog.bytes.size(); i++)
+    {
+        if (hostSpiLog.bytes[i] == 0xFF)
+            unlit++;
+        else if (hostSpiLog.bytes[i] == 0x7F)
+            lit++;
+    }
+    CHECK(lit == DMD_BITSPERPIXEL && unlit == (int)hostSpiLog.bytes.size() - DMD_BITSPERPIXEL);
+
+    // each column byte goes out as rows 12, 8, 4, 0 of its scan line, in both scan modes:
+    // pixel, scan line, byte position in the line, and the byte sent
+    const struct
+    {
+        int x, y, line, at;
+        byte sent;
+    } order[] = {
+        {0, 12, 0, 0 * 4 + 0, 0x7F},  // row 3 of line 0, byte 0
+        {9, 8, 0, 1 * 4 + 1, 0xBF},   // row 2, byte 1
+        {50, 4, 0, 6 * 4 + 2, 0xDF},  // row 1, second panel
+        {31, 0, 0, 3 * 4 + 3, 0xFE},  // row 0
+        {63, 13, 1, 7 * 4 + 0, 0xFE}, // row 3 of line 1, last byte
+        {32, 6, 2, 4 * 4 + 2, 0x7F},  // row 1 of line 2
+        {7, 3, 3, 0 * 4 + 3, 0xFE},   // row 0 of line 3
+    };
+    for (byte mode = SCAN_MODE_BYTEWISE; mode <= SCAN_MODE_BURST; mode++)
+    {
+        dmd.setScanMode(mode);
+        dmd.clearScreen(true);
+        for (unsigned p = 0; p < sizeof(order) / sizeof(order[0]); p++)
+            dmd.writePixel(order[p].x, order[p].y, GRAPHICS_NORMAL, true);
+        hostSpiReset();
+        for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+            dmd.scanDisplayBySPI();
+        CHECK(hostSpiLog.transactions == 4 * DMD_BITSPERPIXEL * (mode == SCAN_MODE_BURST ? 1 : 8));
+        CHECK(hostSpiLog.bytes.size() == 4 * DMD_BITSPERPIXEL * 32);
+        std::vector<byte> expected(hostSpiLog.bytes.size(), 0xFF);
+        for (unsigned p = 0; p < sizeof(order) / sizeof(order[0]); p++)
+            for (int plane = 0; plane < DMD_BITSPERPIXEL; plane++)
+                expected[(order[p].line * DMD_BITSPERPIXEL + plane) * 32 + order[p].at] = order[p].sent;
+        CHECK(hostSpiLog.bytes == expected);
+    }
+}
+
+static void testBrightness()
+{
+    hostPinsReset();
+    DMD dmd(1, 1);
+    CHECK(dmd.getBrightness() == 255);
+    dmd.setBrightness(128);
+    CHECK(hostPins.ledcAttached[PIN_DMD_nOE]);
+    CHECK(hostPins.ledcDuty[PIN_DMD_nOE] == dmdBrightnessDuty(128, DMD_PWM_RESOLUTION));
+
+    // the scan blanks nOE through the GPIO matrix only, the duty is left alone
+    uint32_t ledcSignal = hostPins.outSignal[PIN_DMD_nOE];
+    uint32_t writes = hostPins.writes[PIN_DMD_nOE], routes = hostPins.routes[PIN_DMD_nOE];
+    CHECK(ledcSignal == LEDC_HS_SIG_OUT0_IDX);
+    CHECK(hostPins.level[PIN_DMD_nOE] == LOW);
+    dmd.scanDisplayBySPI();
+    CHECK(hostPins.writes[PIN_DMD_nOE] == writes && hostPins.routes[PIN_DMD_nOE] == routes + 2);
+    CHECK(hostPins.outSignal[PIN_DMD_nOE] == ledcSignal);
+    CHECK(hostPins.ledcDuty[PIN_DMD_nOE] == dmdBrightnessDuty(128, DMD_PWM_RESOLUTION));
+    dmd.setBrightness(64);
+    CHECK(hostPins.ledcDuty[PIN_DMD_nOE] == dmdBrightnessDuty(64, DMD_PWM_RESOLUTION));
+    dmd.setBrightness(255);
+    CHECK(!hostPins.ledcAttached[PIN_DMD_nOE]);
+    dmd.scanDisplayBySPI();
+    CHECK(hostPins.level[PIN_DMD_nOE] == HIGH);
+
+    CHECK(dmdBrightnessDuty(0, 8) == 0);
+    CHECK(dmdBrightnessDuty(1, 8) == 1);
+    CHECK(dmdBrightnessDuty(255, 8) == 255);
+    for (int b = 1; b < 255; b++)
+        CHECK(dmdBrightnessDuty(b, 8) >= dmdBrightnessDuty(b - 1, 8));
+}
+
+static void testScanTimer()
+{
+    DMD dmd(1, 1);
+    CHECK(dmd.beginScanning(250));
+    hw_timer_t *timer = hostLastTimer();
+    CHECK(timer != NULL);
+    CHECK(hostTimerAlarmUs(timer) == dmd.getScanPeriodUs());
+    hostSpiReset();
+    CHECK(hostTimerFire(timer));
+    CHECK(hostSpiLog.transactions == 1);
+
+    // a bus swapped in while scanning takes over the scan, NULL leaves it in place
+    struct CountingBus : DMDSpiBus
+    {
+        int begins = 0, transactions = 0;
+        void begin(uint8_t, uint8_t) { begins++; }
+        void beginTransaction() { transactions++; }
+        void transfer(uint8_t) {}
+        void writeBytes(const uint8_t *, uint32_t) {}
+        void endTransaction() {}
+    } bus;
+    dmd.setSpiBus(NULL);
+    dmd.setSpiBus(&bus);
+    timer = hostLastTimer();
+    CHECK(timer != NULL);
+    hostSpiReset();
+    CHECK(hostTimerFire(timer));
+    CHECK(bus.begins == 1 && bus.transactions == 1 && hostSpiLog.transactions == 0);
+    dmd.endScanning();
+    CHECK(hostLastTimer() == NULL);
+
+    // with no scan timer swapBuffers swaps at once, with one that never fires it gives up
+    DMD buffered(1, 1);
+    buffered.clearScreen(true);
+    buffered.enableDoubleBuffer(false);
+    buffered.writePixel(0, 0, GRAPHICS_NORMAL, true);
+    CHECK(buffered.swapBuffers());
+    hostSpiReset();
+    for (uint32_t i = 0; i < 4 * dmdLineTicks(DMD_BITSPERPIXEL); i++)
+        buffered.scanDisplayBySPI();
+    int lit = 0;
+    for (size_t i = 0; i < hostSpiLog.bytes.size(); i++)
+        lit += hostSpiLog.bytes[i] == 0x7F;
+    CHECK(lit == DMD_BITSPERPIXEL);
+    CHECK(buffered.beginScanning(250));
+    buffered.writePixel(1, 0, GRAPHICS_NORMAL, true);
+    CHECK(!buffered.swapBuffers());
+    CHECK(buffered.readPixelLevel(1, 0) == DMD_MAX_INTENSITY);
+    buffered.endScanning();
+}
+
+// A scan timer on a simulated clock, ticked by hand
+struct SimScanTimer : DMDScanTimer
+{
+    uint32_t now = 1000, periodUs = 0;
+    DMDScanCallback callback = NULL;
+    void *arg = NULL;
+    bool start(uint32_t periodUs, DMDScanCallback callback, void *arg)
+    {
+        this->periodUs = periodUs;
+        this->callback = callback;
+        this->arg = arg;
+        return true;
+    }
+    void stop() { callback = NULL; }
+    uint32_t micros() { return now; }
+    void tickAfter(uint32_t us)
+    {
+        now += us;
+        if (callback != NULL)
+            callback(arg);
+    }
+};
+
+static void testScanDeadlines()
+{
+    // the period is clamped to the time a scan line takes at the SPI clock, 4 MHz by default
+    uint32_t minimum = dmdScanLineUs(2, 4000000) + DMD_SCAN_OVERHEAD_US;
+    CHECK(minimum == 64 + DMD_SCAN_OVERHEAD_US);
+    CHECK(dmdScanPeriodUs(60000, 2, 4000000, 1) == minimum);
+    CHECK(dmdScanPeriodUs(0, 2, 4000000, 1) == minimum);
+    CHECK(dmdScanPeriodUs(1, 2, 4000000, 1) == 250000);
+    CHECK(dmdScanPeriodUs(1, 2, 4000000, 4) == 250000 / 15);
+    CHECK(dmdScanPeriodUs(100, 2, 4000000, 2) == 1000000 / (100 * 4 * 3));
+
+    DMD dmd(2, 1);
+    SimScanTimer timer;
+    dmd.setScanTimer(&timer);
+    CHECK(dmd.beginScanning(60000));
+    CHECK(timer.periodUs == minimum && dmd.getScanPeriodUs() == minimum);
+    CHECK(dmd.beginScanning(1));
+    uint32_t period = 250000 / dmdLineTicks(DMD_BITSPERPIXEL);
+    CHECK(timer.periodUs == period && dmd.getScanPeriodUs() == period);
+
+    // ticks on time, or up to a period late, miss nothing
+    for (int i = 0; i < 8; i++)
+        timer.tickAfter(period);
+    timer.tickAfter(period + period / 2);
+    timer.tickAfter(period / 2);
+    CHECK(dmd.getMissedDeadlines() == 0);
+    // a tick that comes a whole period late missed one, and only once
+    timer.tickAfter(2 * period);
+    CHECK(dmd.getMissedDeadlines() == 1);
+    timer.tickAfter(period);
+    timer.tickAfter(period);
+    CHECK(dmd.getMissedDeadlines() == 1);
+    // three periods late, two ticks missed
+    timer.tickAfter(3 * period);
+    CHECK(dmd.getMissedDeadlines() == 3);
+    dmd.endScanning();
+    CHECK(timer.callback == NULL);
+}
+
+static void testPbm()
+{
+    DMD dmd(1, 1);
+    dmd.clearScreen(true);
+    dmd.writePixel(1, 0, GRAPHICS_NORMAL, true);
+    FILE *out = tmpfile();
+    dmdWritePbm(dmd, out);
+    rewind(out);
+    char line[256];
+    CHECK(fgets(line, sizeof(line), out) && strcmp(line, DMD_MAX_INTENSITY == 1 ? "P1\n" : "P2\n") == 0);
+    CHECK(fgets(line, sizeof(line), out) && strcmp(line, "32 16\n") == 0);
+    fclose(out);
+}
+
+struct HostTest
+{
+    const char *name;
+    void (*run)();
+};
+
+static const HostTest tests[] = {
+    {"pixel_read_back", testPixelReadBack},
+    {"grayscale", testGrayscale},
+    {"draw_string", testDrawString},
+    {"marquee_scroll", testMarqueeScroll},
+    {"marquee_strip", testMarqueeStrip},
+    {"arabic_forms", testArabicForms},
+    {"utf8", testUtf8},
+    {"long_text", testLongText},
+    {"shape_cache", testShapeCache},
+    {"bidi", testBidi},
+    {"measure", testMeasure},
+    {"marquee_source", testMarqueeSource},
+    {"marquee_speed", testMarqueeSpeed},
+    {"fixed_layout", testFixedLayout},
+    {"container", testContainer},
+    {"container_glyphs", testContainerGlyphs},
+    {"container_scroll", testContainerScroll},
+    {"compositor", testCompositor},
+    {"shift_screen", testShiftScreen},
+    {"marquee_zones", testMarqueeZones},
+    {"dirty_spans", testDirtySpans},
+    {"scan_bus_traffic", testScanBusTraffic},
+    {"brightness", testBrightness},
+    {"scan_timer", testScanTimer},
+    {"scan_deadlines", testScanDeadlines},
+    {"pbm", testPbm},
+};
+
+int main(int argc, char **argv)
+{
+    int ran = 0;
+    for (unsigned i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        if (argc > 1 && strcmp(argv[1], tests[i].name) != 0)
+            continue;
+        int before = failures;
+        tests[i].run();
+        printf("%s %s\n", failures == before ? "PASS" : "FAIL", tests[i].name);
+        ran++;
+    }
+    if (ran == 0)
+    {
+        fprintf(stderr, "no test named %s\n", argv[1]);
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
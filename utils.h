@@ -5,6 +5,7 @@
 #include "Arduino.h"
 
 #include "constants.h"
+#include "DMDFont.h"
 
 inline int charWidthOfFont(const unsigned char letter, const uint8_t *font)
 {
@@ -38,4 +39,11 @@ inline int charWidthOfFont(const unsigned char letter, const uint8_t *font)
     return width;
 }
 
+// Same as above, served from the glyph table cached by the font handle
+inline int charWidthOfFont(const unsigned char letter, DMDFont &font)
+{
+    // from the font's advance table, where a space is as wide as 'n'
+    return font.getAdvance(letter);
+}
+
 #endif
\ No newline at end of file